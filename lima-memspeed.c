@@ -38,6 +38,7 @@
 #include "arm-neon.h"
 #include "memspeed_gpu.h"
 #include "memspeed_fb.h"
+#include "memtester-4.3.0/kernels.h"
 
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(a)  (sizeof((a)) / sizeof((a)[0]))
@@ -84,6 +85,43 @@ static void *cpu_thread(void *data)
 	return 0;
 }
 
+/* Wrappers for the kernels picked at runtime by kernels_init() */
+
+static void dispatched_fill(int64_t *dst, int64_t *src, int size)
+{
+	size_t half = size / 2;
+	memtester_kernels.fill((unsigned long *)dst,
+			       (unsigned long *)((char *)dst + half),
+			       half / sizeof(unsigned long),
+			       0xCCCCCCCC, 0x33333333);
+}
+
+static void dispatched_fill_nt(int64_t *dst, int64_t *src, int size)
+{
+	size_t half = size / 2;
+	memtester_kernels_streaming.fill((unsigned long *)dst,
+					 (unsigned long *)((char *)dst + half),
+					 half / sizeof(unsigned long),
+					 0xCCCCCCCC, 0x33333333);
+}
+
+static void dispatched_read(int64_t *dst, int64_t *src, int size)
+{
+	unsigned long va, vb;
+	size_t half = size / 2;
+	memtester_kernels.compare((unsigned long *)src,
+				  (unsigned long *)((char *)src + half),
+				  half / sizeof(unsigned long), &va, &vb);
+}
+
+static void dispatched_copy(int64_t *dst, int64_t *src, int size)
+{
+	size_t half = size / 2;
+	memtester_kernels.copy((unsigned long *)dst,
+			       (unsigned long *)((char *)src + half),
+			       half / sizeof(unsigned long));
+}
+
 static workload_t workloads_list[] = {
 	{
 		.name = "fb_blank",
@@ -105,6 +143,30 @@ static workload_t workloads_list[] = {
 		.description = "use the lima driver to copy a texture to the screen",
 		.thread_func = gpu_copy_thread,
 	},
+	{
+		.name = "cpu_write",
+		.description = "use the fastest available CPU kernel to fill a memory buffer",
+		.thread_func = cpu_thread,
+		.extra_data = dispatched_fill,
+	},
+	{
+		.name = "cpu_write_nt",
+		.description = "fill a memory buffer with streaming stores, bypassing the caches",
+		.thread_func = cpu_thread,
+		.extra_data = dispatched_fill_nt,
+	},
+	{
+		.name = "cpu_read",
+		.description = "use the fastest available CPU kernel to compare two buffers",
+		.thread_func = cpu_thread,
+		.extra_data = dispatched_read,
+	},
+	{
+		.name = "cpu_copy",
+		.description = "use the fastest available CPU kernel to copy a memory buffer",
+		.thread_func = cpu_thread,
+		.extra_data = dispatched_copy,
+	},
 	{
 		.name = "neon_write",
 		.description = "use ARM NEON to fill a memory buffer",
@@ -170,6 +232,8 @@ int main(int argc, char *argv[])
 	if (argc < 2)
 		show_help_and_exit();
 
+	kernels_init(1);
+
 	workloads = calloc(argc - 1, sizeof(workload_t));
 	assert(workloads);
 
@@ -178,6 +242,12 @@ int main(int argc, char *argv[])
 		int workload_found = 0;
 		for (j = 0; j < ARRAY_SIZE(workloads_list); j++) {
 			if (strcmp(argv[i], workloads_list[j].name) == 0) {
+				if (strncmp(argv[i], "neon_", 5) == 0 &&
+				    !cpu_has_neon()) {
+					printf("'%s' needs a CPU with NEON, try the "
+					       "cpu_* workloads instead\n", argv[i]);
+					exit(1);
+				}
 				workloads[number_of_workloads++] = workloads_list[j];
 				workload_found = 1;
 			}
@@ -18,6 +18,7 @@
 #include <assert.h>
 
 #include "types.h"
+#include "kernels.h"
 
 #define BUFSIZE (256 * 1024)
 
@@ -65,6 +66,8 @@ int main()
     ul *buf1 = malloc(BUFSIZE * sizeof(ulv));
     ul *buf2 = malloc(BUFSIZE * sizeof(ulv));
 
+    kernels_init(1);
+
     for (repeat = 0; repeat < 10000; repeat++)
     {
         ul offs1, offs2, v1a, v1b, v2a, v2b;
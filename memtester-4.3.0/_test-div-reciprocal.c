@@ -0,0 +1,111 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains a simple test for the 'div_regions_*' implementations,
+ * checking them against the '/' operator.  Build it together with
+ * kernels.c (and arm-asm-helpers.S on ARM).
+ *
+ */
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "types.h"
+#include "kernels.h"
+
+/* Not a multiple of the SIMD block size, so that the tail is covered too. */
+#define BUFSIZE (4 * 1024 + 7)
+
+static ul rand_word(void) {
+    ul v = 0;
+    size_t i;
+
+    for (i = 0; i < sizeof(ul); i++)
+        v = (v << 8) ^ (rand() & 0xFF);
+    return v;
+}
+
+/* Values close to a multiple of q, where a wrong reciprocal shows first. */
+static ul dividend(ul q, size_t i) {
+    switch (i % 8) {
+        case 0:  return rand_word();
+        case 1:  return rand_word() >> (rand() % (sizeof(ul) * CHAR_BIT));
+        case 2:  return (rand_word() / q) * q;
+        case 3:  return (rand_word() / q) * q - 1;
+        case 4:  return (rand_word() / q) * q + q - 1;
+        case 5:  return ULONG_MAX - i / 8;
+        case 6:  return i / 8;
+        default: return (ULONG_MAX / q) * q + (rand_word() % q);
+    }
+}
+
+static int check_divisor(ul q, ul *buf1, ul *buf2, ul *ref) {
+    memtester_divisor_t d;
+    size_t i;
+
+    for (i = 0; i < BUFSIZE; i++) {
+        buf1[i] = buf2[i] = dividend(q, i);
+        ref[i] = buf1[i] / q;
+    }
+    divisor_init(&d, q);
+    div_regions(buf1, buf2, BUFSIZE, &d);
+
+    for (i = 0; i < BUFSIZE; i++) {
+        if (buf1[i] != ref[i] || buf2[i] != ref[i]) {
+            printf("%s: q=%08lX index=%lu (%08lX, %08lX) != %08lX\n",
+                   memtester_kernels.name, q, (unsigned long) i, buf1[i],
+                   buf2[i], ref[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int check_all(ul *buf1, ul *buf2, ul *ref) {
+    const int bits = sizeof(ul) * CHAR_BIT;
+    int repeat, k, failed = 0;
+
+    for (k = 0; k < bits; k++) {
+        ul p = (ul) 1 << k;
+        failed |= check_divisor(p, buf1, buf2, ref);
+        failed |= check_divisor(p + 1, buf1, buf2, ref);
+        if (p > 1)
+            failed |= check_divisor(p - 1, buf1, buf2, ref);
+    }
+    for (k = 1; k < 16; k++)
+        failed |= check_divisor(k, buf1, buf2, ref);
+    failed |= check_divisor(ULONG_MAX, buf1, buf2, ref);
+    failed |= check_divisor(ULONG_MAX - 1, buf1, buf2, ref);
+
+    for (repeat = 0; repeat < 2000 && !failed; repeat++) {
+        ul q = rand_word() >> (rand() % bits);
+        failed |= check_divisor(q ? q : 1, buf1, buf2, ref);
+    }
+    return failed;
+}
+
+int main()
+{
+    int failed;
+    ul *buf1 = malloc(BUFSIZE * sizeof(ul));
+    ul *buf2 = malloc(BUFSIZE * sizeof(ul));
+    ul *ref = malloc(BUFSIZE * sizeof(ul));
+
+    /* The scalar kernels are bound until kernels_init() is called. */
+    failed = check_all(buf1, buf2, ref);
+    kernels_init(1);
+    failed |= check_all(buf1, buf2, ref);
+
+    printf("%s\n", failed ? "FAILED" : "ok");
+    free(buf1);
+    free(buf2);
+    free(ref);
+    return failed;
+}
@@ -0,0 +1,68 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains a regression test for the mirroring of bufb between
+ * the tests: with -b, a history which puts Modulo 20 before Compare XOR
+ * made Compare XOR start from buffers which Modulo 20 had left different,
+ * and fail on good memory.  Build it together with all the other sources
+ * (memtester.c included, without memtester-evlog.c and the other tests).
+ *
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+int memtester_main(int argc, char **argv);
+
+/* Modulo 20 fails often and is cheap, so -b runs it first. */
+static const char history[] =
+    "10 9 0.000100000 D Modulo 20\n"
+    "10 0 1.000000000 D Compare XOR\n";
+
+int main(void) {
+    char path[] = "/tmp/memtester-mirror-XXXXXX";
+    char *args[] = { "memtester", "-b", "1h", "4M", "1", NULL };
+    int fd, status;
+    pid_t pid;
+
+    fd = mkstemp(path);
+    if (fd < 0 || write(fd, history, sizeof(history) - 1) !=
+                  (ssize_t) (sizeof(history) - 1)) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+    setenv("MEMTESTER_STATE_FILE", path, 1);
+    setenv("MEMTESTER_TESTS", "Compare XOR,Modulo 20", 1);
+    setenv("MEMTESTER_SKIP_STUCK_ADDRESS", "1", 1);
+    setenv("MEMTESTER_PROGRESS_INTERVAL", "0", 1);
+
+    /* memtester_main() exits, run it in a child. */
+    pid = fork();
+    if (pid == 0) {
+        memtester_main(5, args);
+        _exit(127);
+    }
+    if (pid < 0 || waitpid(pid, &status, 0) != pid) {
+        perror("fork");
+        unlink(path);
+        return 1;
+    }
+    unlink(path);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "Modulo 20 then Compare XOR: memtester failed "
+                "(status 0x%x)\n", status);
+        return 1;
+    }
+    printf("Modulo 20 then Compare XOR: ok\n");
+    return 0;
+}
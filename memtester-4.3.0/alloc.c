@@ -0,0 +1,292 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the test buffer allocator.  It replaces the old
+ * malloc()/mlock() loop, which gave back one page per failed attempt and
+ * could take tens of thousands of attempts on a board short of memory.
+ *
+ */
+
+/* MAP_ANONYMOUS and MAP_HUGETLB are not in POSIX. */
+#define _DEFAULT_SOURCE
+#define _BSD_SOURCE
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include "types.h"
+#include "alloc.h"
+#include "threads.h"
+
+/* Read a value from /proc/meminfo, in bytes.  Returns 0 if unavailable. */
+static size_t meminfo_bytes(const char *key) {
+    FILE *f = fopen("/proc/meminfo", "r");
+    char line[128];
+    size_t keylen = strlen(key);
+    unsigned long long kb = 0;
+
+    if (!f)
+        return 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, key, keylen) == 0 && line[keylen] == ':') {
+            kb = strtoull(line + keylen + 1, NULL, 10);
+            break;
+        }
+    }
+    fclose(f);
+    if (kb > ((size_t) -1) >> 10)
+        return (size_t) -1;
+    return (size_t) kb << 10;
+}
+
+/* Amount of the mapping at 'addr' backed by transparent huge pages. */
+static size_t thp_backed_bytes(void volatile *addr) {
+    FILE *f = fopen("/proc/self/smaps", "r");
+    char line[256];
+    unsigned long start, end;
+    unsigned long long kb = 0;
+    int found = 0;
+
+    if (!f)
+        return 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            found = (start <= (unsigned long) addr &&
+                     (unsigned long) addr < end);
+        } else if (found && strncmp(line, "AnonHugePages:", 14) == 0) {
+            kb = strtoull(line + 14, NULL, 10);
+            break;
+        }
+    }
+    fclose(f);
+    return (size_t) kb << 10;
+}
+
+/*
+ * Map 'size' bytes, preferring huge pages.  The size may be rounded down
+ * to a multiple of the huge page size.
+ */
+static void *map_buffer(memtester_buffer *b, size_t size, size_t pagesize) {
+    void *p;
+#ifdef MAP_HUGETLB
+    size_t hugesize = meminfo_bytes("Hugepagesize");
+
+    if (hugesize > pagesize && size >= hugesize) {
+        p = mmap(NULL, size & ~(hugesize - 1), PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            b->size = size & ~(hugesize - 1);
+            b->pagesize = hugesize;
+            b->page_kind = MEMTESTER_PAGES_HUGETLB;
+            return p;
+        }
+    }
+#endif
+    p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+             -1, 0);
+    if (p == MAP_FAILED)
+        return NULL;
+    b->size = size;
+    b->pagesize = pagesize;
+    b->page_kind = MEMTESTER_PAGES_NORMAL;
+#ifdef MADV_HUGEPAGE
+    /*
+     * The kernel may still back the range with small pages, so the buffer
+     * is prefaulted page by page, b->pagesize is only raised once the huge
+     * pages show up in smaps.
+     */
+    if (madvise(p, size, MADV_HUGEPAGE) == 0 &&
+        meminfo_bytes("Hugepagesize") > pagesize) {
+        b->page_kind = MEMTESTER_PAGES_THP;
+    }
+#endif
+    return p;
+}
+
+/*
+ * Number of threads used to fault in the buffer before locking it.  A
+ * single mlock() call faults and zeroes every page on one core, which takes
+ * many seconds for a large buffer on a Cortex-A7.
+ */
+int memtester_prefault_threads = 1;
+
+struct prefault_job {
+    char volatile *base;
+    size_t size;
+    size_t pagesize;
+};
+
+static void prefault_stripe(void *arg, int id, int n) {
+    struct prefault_job *job = arg;
+    size_t pages = job->size / job->pagesize;
+    size_t first = pages * id / n, last = pages * (id + 1) / n, i;
+
+    for (i = first; i < last; i++)
+        job->base[i * job->pagesize] = 0;
+}
+
+static void prefault(memtester_buffer *b) {
+    struct prefault_job job;
+
+    if (memtester_prefault_threads <= 1)
+        return;
+    job.base = (char volatile *) b->base;
+    job.size = b->size;
+    job.pagesize = b->pagesize;
+    memtester_run_parallel(prefault_stripe, &job, memtester_prefault_threads);
+}
+
+/* Map and optionally lock 'size' bytes.  Returns 0 or an errno value. */
+static int probe(memtester_buffer *b, size_t size, size_t pagesize,
+                 int do_mlock) {
+    void *p = map_buffer(b, size, pagesize);
+
+    if (!p)
+        return errno ? errno : ENOMEM;
+    b->base = p;
+    b->locked = 0;
+    printf("got  %lluMB (%llu bytes)", (ull) b->size >> 20, (ull) b->size);
+    if (!do_mlock) {
+        printf("\n");
+        return 0;
+    }
+    printf(", trying mlock ...");
+    fflush(stdout);
+    prefault(b);
+    if (mlock(p, b->size) < 0) {
+        int err = errno;
+        munmap(p, b->size);
+        b->base = NULL;
+        return err;
+    }
+    printf("locked.\n");
+    b->locked = 1;
+    return 0;
+}
+
+/*
+ * Largest size below 'bad' which can be mapped (and locked).  Successful
+ * probes are released right away, otherwise they would count against the
+ * limits while probing the larger sizes.  Every locked probe faults in
+ * the whole size, so the search stops within 1% of 'bad' (or a huge
+ * page, if that is larger) rather than going down to single pages.
+ */
+static int binary_search(memtester_buffer *b, size_t bad, size_t pagesize,
+                         int do_mlock) {
+    memtester_buffer cur;
+    size_t good = 0, mid, step;
+    int err;
+
+    step = meminfo_bytes("Hugepagesize");
+    if (step < bad / 100)
+        step = bad / 100;
+    step = step > pagesize ? step & ~(pagesize - 1) : pagesize;
+    while (bad - good > step) {
+        mid = (good + (bad - good) / 2) & ~(pagesize - 1);
+        if (mid <= good)
+            mid = good + pagesize;
+        err = probe(&cur, mid, pagesize, do_mlock);
+        if (err == 0) {
+            memtester_free(&cur);
+            good = mid;
+        } else if (err == ENOMEM || err == EAGAIN) {
+            printf(err == EAGAIN ? "over system/pre-process limit, "
+                                   "reducing...\n"
+                                 : "too many pages, reducing...\n");
+            bad = mid;
+        } else {
+            break;
+        }
+    }
+    if (!good)
+        return -1;
+    return probe(b, good, pagesize, do_mlock) == 0 ? 0 : -1;
+}
+
+int memtester_alloc(memtester_buffer *b, size_t wantbytes, size_t pagesize,
+                    int do_mlock) {
+    size_t size = wantbytes & ~(pagesize - 1), limit, thp, hugesize;
+    struct rlimit rl;
+    int err;
+
+    memset(b, 0, sizeof(*b));
+
+    /* Do not even try sizes which cannot possibly be locked. */
+    if (do_mlock) {
+        limit = meminfo_bytes("MemAvailable");
+        if (limit && limit < size) {
+            printf("MemAvailable is only %lluMB, limiting the request\n",
+                   (ull) limit >> 20);
+            size = limit & ~(pagesize - 1);
+        }
+        if (geteuid() != 0 && getrlimit(RLIMIT_MEMLOCK, &rl) == 0 &&
+            rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur < size) {
+            printf("RLIMIT_MEMLOCK is only %lluKB, limiting the request\n",
+                   (ull) rl.rlim_cur >> 10);
+            size = rl.rlim_cur & ~(pagesize - 1);
+        }
+        if (size < pagesize)
+            size = pagesize;
+    }
+
+    err = probe(b, size, pagesize, do_mlock);
+    if (err == ENOMEM || err == EAGAIN) {
+        printf(err == EAGAIN ? "over system/pre-process limit, reducing...\n"
+                             : "too many pages, reducing...\n");
+        if (binary_search(b, size, pagesize, do_mlock) == 0)
+            err = 0;
+    }
+    if (err == EPERM) {
+        printf("insufficient permission.\n");
+        printf("Trying again, unlocked:\n");
+        return memtester_alloc(b, wantbytes, pagesize, 0);
+    }
+    if (err != 0 && do_mlock) {
+        printf("failed for unknown reason.\n");
+        return memtester_alloc(b, wantbytes, pagesize, 0);
+    }
+    if (err != 0)
+        return -1;
+
+    switch (b->page_kind) {
+        case MEMTESTER_PAGES_HUGETLB:
+            printf("buffer uses %lukB huge pages\n",
+                   (unsigned long) (b->pagesize >> 10));
+            break;
+        case MEMTESTER_PAGES_THP:
+            thp = thp_backed_bytes(b->base);
+            hugesize = meminfo_bytes("Hugepagesize");
+            if (thp && thp >= (b->size & ~(hugesize - 1)))
+                b->pagesize = hugesize;
+            printf("buffer uses transparent huge pages: %lluMB of %lluMB "
+                   "in %lukB pages\n", (ull) thp >> 20,
+                   (ull) b->size >> 20, (unsigned long) (b->pagesize >> 10));
+            break;
+        default:
+            printf("buffer uses %lukB pages\n",
+                   (unsigned long) (b->pagesize >> 10));
+    }
+    return 0;
+}
+
+void memtester_free(memtester_buffer *b) {
+    if (!b->base)
+        return;
+    if (b->locked)
+        munlock((void *) b->base, b->size);
+    munmap((void *) b->base, b->size);
+    b->base = NULL;
+}
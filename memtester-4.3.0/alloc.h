@@ -0,0 +1,50 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the test buffer allocator.
+ *
+ */
+
+#ifndef MEMTESTER_ALLOC_H
+#define MEMTESTER_ALLOC_H
+
+#include <stddef.h>
+
+#define MEMTESTER_PAGES_NORMAL  0
+#define MEMTESTER_PAGES_HUGETLB 1 /* MAP_HUGETLB */
+#define MEMTESTER_PAGES_THP     2 /* madvise(MADV_HUGEPAGE) */
+
+typedef struct memtester_buffer {
+    void volatile *base;
+    size_t size;        /* bytes usable for testing */
+    size_t pagesize;    /* size of the pages backing the buffer */
+    int page_kind;      /* one of MEMTESTER_PAGES_* */
+    int locked;
+} memtester_buffer;
+
+/*
+ * Number of threads faulting in the buffer in parallel before it is locked
+ * (each one touches its own stripe of pages), 1 to leave it all to mlock().
+ */
+extern int memtester_prefault_threads;
+
+/*
+ * Allocate up to 'wantbytes' for testing, locked in memory if 'do_mlock'
+ * is set.  Huge pages are tried first.  If the whole size cannot be
+ * locked, the largest lockable size is found by a binary search, starting
+ * from the limits in /proc/meminfo and RLIMIT_MEMLOCK.  If locking is not
+ * permitted at all, the buffer is returned unlocked.  Returns 0 on success.
+ */
+int memtester_alloc(memtester_buffer *b, size_t wantbytes, size_t pagesize,
+                    int do_mlock);
+
+void memtester_free(memtester_buffer *b);
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the cache maintenance helpers.
+ *
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "cache.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <cpuid.h>
+
+#define CACHE_LINE 64
+
+/* CPUID.(EAX=7,ECX=0):EBX bit 23. */
+static int cpu_has_clflushopt(void) {
+    static int has = -1;
+    unsigned int eax, ebx, ecx, edx;
+
+    if (has < 0) {
+        has = __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+              (ebx & (1 << 23));
+    }
+    return has;
+}
+
+void cache_flush_range(void volatile *addr, size_t len) {
+    char volatile *p = (char volatile *) ((size_t) addr & ~(CACHE_LINE - 1));
+    char volatile *end = (char volatile *) addr + len;
+
+    __asm__ volatile("mfence" ::: "memory");
+    /*
+     * CLFLUSHOPT does the same but is only ordered by the fences, so the
+     * flushes of a large range overlap instead of going one by one.
+     */
+    if (cpu_has_clflushopt()) {
+        for (; p < end; p += CACHE_LINE)
+            __asm__ volatile("clflushopt %0" : "+m" (*p) :: "memory");
+    } else {
+        for (; p < end; p += CACHE_LINE)
+            __asm__ volatile("clflush %0" : "+m" (*p) :: "memory");
+    }
+    __asm__ volatile("mfence" ::: "memory");
+}
+
+void cache_flush_list(void volatile *const *addrs, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        cache_flush_range(addrs[i], 1);
+}
+
+#elif defined(__aarch64__)
+
+void cache_flush_range(void volatile *addr, size_t len) {
+    unsigned long ctr;
+    size_t line;
+    char volatile *p, *end = (char volatile *) addr + len;
+
+    /* CTR_EL0.DminLine is log2 of the smallest line size in words. */
+    __asm__ volatile("mrs %0, ctr_el0" : "=r" (ctr));
+    line = (size_t) 4 << ((ctr >> 16) & 0xf);
+    p = (char volatile *) ((size_t) addr & ~(line - 1));
+    __asm__ volatile("dsb sy" ::: "memory");
+    for (; p < end; p += line)
+        __asm__ volatile("dc civac, %0" :: "r" (p) : "memory");
+    __asm__ volatile("dsb sy" ::: "memory");
+}
+
+void cache_flush_list(void volatile *const *addrs, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        cache_flush_range(addrs[i], 1);
+}
+
+#else
+
+#include <pthread.h>
+#include <string.h>
+
+/* Larger than the L2 cache of the Allwinner SoCs and most other boards. */
+#define EVICTION_BUFFER_SIZE (2 * 1024 * 1024)
+#define EVICTION_STRIDE 32
+
+static unsigned char volatile *eviction_buffer;
+static pthread_once_t eviction_once = PTHREAD_ONCE_INIT;
+
+/*
+ * The buffer is written once, so that its pages are backed by real memory:
+ * pages which were only ever read all map the kernel's shared zero page,
+ * and reading them would not evict anything.
+ */
+static void eviction_init(void) {
+    unsigned char *buf = malloc(EVICTION_BUFFER_SIZE);
+
+    if (buf)
+        memset(buf, 0x5a, EVICTION_BUFFER_SIZE);
+    eviction_buffer = buf;
+}
+
+void cache_flush_range(void volatile *addr, size_t len) {
+    unsigned char sum = 0;
+    size_t i;
+
+    pthread_once(&eviction_once, eviction_init);
+    if (!eviction_buffer)
+        return;
+    for (i = 0; i < EVICTION_BUFFER_SIZE; i += EVICTION_STRIDE)
+        sum += eviction_buffer[i];
+    (void) sum;
+}
+
+void cache_flush_list(void volatile *const *addrs, size_t n) {
+    /* The eviction does not depend on the addresses, one pass covers all. */
+    if (n)
+        cache_flush_range(addrs[0], 1);
+}
+
+#endif
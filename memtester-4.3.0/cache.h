@@ -0,0 +1,36 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the cache maintenance helpers.
+ *
+ */
+
+#ifndef MEMTESTER_CACHE_H
+#define MEMTESTER_CACHE_H
+
+#include <stddef.h>
+
+/*
+ * Write back and invalidate the cache lines covering [addr, addr + len),
+ * so that the next access goes to DRAM.  Uses clflush (clflushopt when the
+ * CPU has it) on x86 and DC CIVAC on AArch64.  32-bit ARM has no cache
+ * maintenance usable from user space, so there the whole cache hierarchy is
+ * evicted by reading a buffer larger than the last level cache.
+ */
+void cache_flush_range(void volatile *addr, size_t len);
+
+/*
+ * Write back and invalidate the cache lines holding the 'n' bytes at
+ * addrs[0] .. addrs[n - 1].  On 32-bit ARM this is a single eviction for
+ * all of them, so scattered words should be flushed with one call.
+ */
+void cache_flush_list(void volatile *const *addrs, size_t n);
+
+#endif
@@ -0,0 +1,305 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the DRAM geometry model.  Failures are decoded from
+ * their physical address to a byte lane, column, bank and row, and counted
+ * per bank, per row and per DQ bit, which tells apart a bad chip or data
+ * line from a timing problem hitting every bank.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "types.h"
+#include "memtester.h"
+#include "pagemap.h"
+#include "dram.h"
+
+#define HEAT_LEVELS " .:-=+*#%@"
+
+const dram_geometry *memtester_dram = NULL;
+
+/* Address bits, from the lowest: byte lane, column, bank, row. */
+static void decode_linear(const dram_geometry *g, ull phys,
+                          dram_location *loc) {
+    ull a = phys - g->base;
+
+    loc->lane = a % g->bus_bytes;
+    a /= g->bus_bytes;
+    loc->col = a & ((1UL << g->col_bits) - 1);
+    a >>= g->col_bits;
+    loc->bank = a & ((1UL << g->bank_bits) - 1);
+    a >>= g->bank_bits;
+    loc->row = a & ((1UL << g->row_bits) - 1);
+}
+
+static ull encode_linear(const dram_geometry *g, const dram_location *loc) {
+    ull a = loc->row;
+
+    a = (a << g->bank_bits) | loc->bank;
+    a = (a << g->col_bits) | loc->col;
+    return g->base + a * g->bus_bytes + loc->lane;
+}
+
+static const dram_geometry dram_models[] = {
+    /* The sun4i/sun7i DRAMC maps row, bank and column linearly above the
+       32-bit bus, DDR3 parts have 8 banks and 1024 columns. */
+    { "a10", "allwinner,sun4i-a10", 0x40000000ULL, 4, 10, 3, 0,
+      decode_linear, encode_linear },
+    { "a20", "allwinner,sun7i-a20", 0x40000000ULL, 4, 10, 3, 0,
+      decode_linear, encode_linear },
+    /* Everything from MEMTESTER_DRAM_GEOMETRY. */
+    { "generic", NULL, 0, sizeof(ul), 10, 3, 0, decode_linear,
+      encode_linear },
+    { NULL }
+};
+
+static dram_geometry geometry;
+
+static ull bank_errors[1 << DRAM_MAX_BANK_BITS];
+static ull dq_errors[DRAM_MAX_BUS_BYTES * 8];
+static struct row_count {
+    unsigned long row;
+    ull count;
+} row_errors[DRAM_MAX_ROWS];
+static size_t nrows;
+static ull other_row_errors;
+static ull unsided_errors;
+
+static int dt_compatible(const char *compatible) {
+    char buf[512];
+    size_t n, i;
+    FILE *f = fopen("/proc/device-tree/compatible", "r");
+
+    if (!f)
+        return 0;
+    n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    /* The property is a list of NUL separated strings. */
+    for (i = 0; i < n; i += strlen(buf + i) + 1) {
+        if (strcmp(buf + i, compatible) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+static unsigned int log2_ceil(ull v) {
+    unsigned int n = 0;
+
+    while ((1ULL << n) < v)
+        n++;
+    return n;
+}
+
+/* "base:bus_bytes:col_bits:bank_bits:row_bits", empty fields are kept. */
+static int parse_geometry(dram_geometry *g, const char *s) {
+    unsigned long v[5] = { 0 };
+    int set[5] = { 0 }, i;
+    char *end;
+
+    for (i = 0; i < 5 && *s; i++) {
+        if (*s != ':') {
+            v[i] = strtoull(s, &end, 0);
+            if (end == s)
+                return -1;
+            set[i] = 1;
+            s = end;
+        }
+        if (*s == ':')
+            s++;
+        else if (*s)
+            return -1;
+    }
+    if (set[0]) g->base = v[0];
+    if (set[1]) g->bus_bytes = v[1];
+    if (set[2]) g->col_bits = v[2];
+    if (set[3]) g->bank_bits = v[3];
+    if (set[4]) g->row_bits = v[4];
+    if (g->bus_bytes == 0 || g->bus_bytes > DRAM_MAX_BUS_BYTES ||
+        (g->bus_bytes & (g->bus_bytes - 1)) ||
+        g->bank_bits > DRAM_MAX_BANK_BITS || g->col_bits > 16 ||
+        g->row_bits > 24)
+        return -1;
+    return 0;
+}
+
+void dram_init(void) {
+    const char *name = getenv("MEMTESTER_DRAM_MODEL");
+    const char *env_geometry = getenv("MEMTESTER_DRAM_GEOMETRY");
+    const dram_geometry *m;
+    ull total;
+    unsigned int low_bits;
+
+    for (m = dram_models; m->name; m++) {
+        if (name ? strcmp(name, m->name) == 0
+                 : m->compatible && dt_compatible(m->compatible))
+            break;
+    }
+    if (!m->name && env_geometry)
+        m = &dram_models[sizeof(dram_models) / sizeof(*m) - 2];
+    if (!m->name) {
+        if (name && strcmp(name, "none") != 0)
+            fprintf(stderr, "unknown MEMTESTER_DRAM_MODEL %s\n", name);
+        return;
+    }
+    geometry = *m;
+    if (env_geometry && parse_geometry(&geometry, env_geometry) != 0) {
+        fprintf(stderr, "bad MEMTESTER_DRAM_GEOMETRY %s, expected "
+                "base:bus_bytes:col_bits:bank_bits:row_bits\n", env_geometry);
+        return;
+    }
+    if (!geometry.row_bits) {
+        /* Whatever the installed size leaves above the bank bits. */
+        total = (ull) sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGE_SIZE);
+        low_bits = log2_ceil(geometry.bus_bytes) + geometry.col_bits +
+                   geometry.bank_bits;
+        geometry.row_bits = log2_ceil(total) > low_bits
+                            ? log2_ceil(total) - low_bits : 1;
+    }
+    memtester_dram = &geometry;
+    printf("DRAM model %s: base 0x%llx, %u-bit bus, %u banks, %lu rows, "
+           "%lu columns\n", geometry.name, geometry.base,
+           geometry.bus_bytes * 8, 1U << geometry.bank_bits,
+           1UL << geometry.row_bits, 1UL << geometry.col_bits);
+}
+
+/*
+ * Count a failure in 'row'.  Once the table is full, a new row takes the
+ * place of the row with the fewest failures, whose count goes to "other",
+ * so that the rows which keep failing stay in the table.
+ */
+static void count_row(unsigned long row) {
+    size_t i, lowest = 0;
+
+    for (i = 0; i < nrows; i++) {
+        if (row_errors[i].row == row) {
+            row_errors[i].count++;
+            return;
+        }
+        if (row_errors[i].count < row_errors[lowest].count)
+            lowest = i;
+    }
+    if (nrows < DRAM_MAX_ROWS) {
+        lowest = nrows++;
+    } else {
+        other_row_errors += row_errors[lowest].count;
+    }
+    row_errors[lowest].row = row;
+    row_errors[lowest].count = 1;
+}
+
+int dram_phys(size_t offset, ull *phys) {
+    if (use_phys) {
+        *phys = physaddrbase + offset;
+        return 0;
+    }
+    return pagemap_lookup(offset, phys);
+}
+
+int dram_offset(ull phys, size_t *offset) {
+    if (use_phys) {
+        if (phys < (ull) physaddrbase)
+            return -1;
+        *offset = (size_t) (phys - physaddrbase);
+        return 0;
+    }
+    return pagemap_offset(phys, offset);
+}
+
+void dram_record(size_t offset, ul diff) {
+    const dram_geometry *g = memtester_dram;
+    dram_location loc;
+    ull phys;
+    unsigned int byte, bit;
+
+    if (!g)
+        return;
+    if (dram_phys(offset, &phys) != 0 || phys < g->base)
+        return;
+    g->decode(g, phys, &loc);
+    bank_errors[loc.bank]++;
+    count_row(loc.row);
+    /* Byte 'byte' of the (little endian) word sits on lane + byte. */
+    for (byte = 0; byte < sizeof(ul); byte++) {
+        for (bit = 0; bit < 8; bit++) {
+            if (diff >> (byte * 8 + bit) & 1)
+                dq_errors[((loc.lane + byte) % g->bus_bytes) * 8 + bit]++;
+        }
+    }
+}
+
+void dram_count_unsided(ull n) {
+    __atomic_fetch_add(&unsided_errors, n, __ATOMIC_RELAXED);
+}
+
+static char heat(ull count, ull max) {
+    if (!count)
+        return HEAT_LEVELS[0];
+    return HEAT_LEVELS[1 + (count * (sizeof(HEAT_LEVELS) - 3)) / max];
+}
+
+void dram_print(FILE *f) {
+    const dram_geometry *g = memtester_dram;
+    struct row_count tmp;
+    ull max;
+    size_t i, j, best;
+    unsigned int b, nbanks, nbits;
+
+    if (unsided_errors) {
+        fprintf(f, "%llu failures of tests without a fixed pattern are "
+                "counted at the bufa\naddress, the bad word may be its "
+                "copy in bufb.\n", unsided_errors);
+    }
+    if (!g)
+        return;
+    nbanks = 1U << g->bank_bits;
+    nbits = g->bus_bytes * 8;
+
+    fprintf(f, "DRAM failures by bank:");
+    for (b = 0; b < nbanks; b++)
+        fprintf(f, " %u:%llu", b, bank_errors[b]);
+    fprintf(f, "\n");
+
+    for (max = 0, b = 0; b < nbits; b++)
+        max = dq_errors[b] > max ? dq_errors[b] : max;
+    fprintf(f, "DRAM failures by DQ bit (lane 0 first): [");
+    for (b = 0; b < nbits; b++) {
+        if (b && b % 8 == 0)
+            fputc('|', f);
+        fputc(heat(dq_errors[b], max), f);
+    }
+    fprintf(f, "]\n ");
+    for (b = 0; b < nbits; b++) {
+        if (dq_errors[b])
+            fprintf(f, " DQ%u:%llu", b, dq_errors[b]);
+    }
+    fprintf(f, "\n");
+
+    /* Sort the rows by failure count, there are few of them. */
+    for (i = 0; i < nrows; i++) {
+        for (best = i, j = i + 1; j < nrows; j++) {
+            if (row_errors[j].count > row_errors[best].count)
+                best = j;
+        }
+        tmp = row_errors[i];
+        row_errors[i] = row_errors[best];
+        row_errors[best] = tmp;
+    }
+    fprintf(f, "DRAM failures by row:");
+    for (i = 0; i < nrows; i++)
+        fprintf(f, " 0x%lx:%llu", row_errors[i].row, row_errors[i].count);
+    if (other_row_errors)
+        fprintf(f, " other:%llu", other_row_errors);
+    fprintf(f, "\n");
+}
@@ -0,0 +1,82 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the DRAM geometry model.
+ *
+ */
+
+#ifndef MEMTESTER_DRAM_H
+#define MEMTESTER_DRAM_H
+
+#include <stdio.h>
+
+#define DRAM_MAX_BANK_BITS 4
+#define DRAM_MAX_BUS_BYTES 8
+#define DRAM_MAX_ROWS 32    /* rows with their own failure counter, the worst */
+
+/* Position of a byte in the DRAM array. */
+typedef struct dram_location {
+    unsigned int lane;      /* byte lane of the data bus */
+    unsigned int col;
+    unsigned int bank;
+    unsigned long row;
+} dram_location;
+
+typedef struct dram_geometry dram_geometry;
+
+struct dram_geometry {
+    const char *name;
+    const char *compatible;     /* device tree match, NULL if none */
+    unsigned long long base;    /* physical address of the first byte */
+    unsigned int bus_bytes;
+    unsigned int col_bits;
+    unsigned int bank_bits;
+    unsigned int row_bits;      /* 0: derived from the memory size */
+    void (*decode)(const dram_geometry *g, unsigned long long phys,
+                   dram_location *loc);
+    unsigned long long (*encode)(const dram_geometry *g,
+                                 const dram_location *loc);
+};
+
+/* The model in use, NULL if failures are not mapped to the DRAM array. */
+extern const dram_geometry *memtester_dram;
+
+/*
+ * Pick the model named by MEMTESTER_DRAM_MODEL, or the one matching the
+ * device tree, and apply the overrides from MEMTESTER_DRAM_GEOMETRY.  Only
+ * called when failures can be translated to physical addresses.
+ */
+void dram_init(void);
+
+/*
+ * Translate between offsets into the test buffer and physical addresses,
+ * with -p or through the pagemap table.  Return 0 on success.
+ */
+int dram_phys(size_t offset, unsigned long long *phys);
+int dram_offset(unsigned long long phys, size_t *offset);
+
+/*
+ * Account a mismatching word at 'offset' bytes into the buffer, 'diff'
+ * being the XOR of the expected and actual values.  Called on the failure
+ * path only, with the error map lock held.
+ */
+void dram_record(size_t offset, unsigned long diff);
+
+/*
+ * Count 'n' mismatches between bufa and bufb which were recorded at the
+ * bufa address because the test has no fixed pattern telling which of the
+ * two words is wrong.  Safe to call from any worker.
+ */
+void dram_count_unsided(unsigned long long n);
+
+/* Print the per-bank, per-row and per-DQ bit failure counters. */
+void dram_print(FILE *f);
+
+#endif
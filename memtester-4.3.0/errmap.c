@@ -0,0 +1,184 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the error map, which collects every mismatch found by
+ * the tests instead of only the one which is reported.
+ *
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "types.h"
+#include "errmap.h"
+#include "dram.h"
+#include "focus.h"
+#include "evlog.h"
+
+memtester_errmap memtester_errors;
+
+static pthread_mutex_t errmap_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Slot of the word at 'offset' in the table, or of the free slot where it
+ * goes.  NULL if the table is not allocated.  Called with the mutex held.
+ */
+static memtester_bad_word *find_word(size_t offset) {
+    memtester_errmap *m = &memtester_errors;
+    size_t i;
+
+    if (!m->words)
+        return NULL;
+    i = (size_t) ((offset / sizeof(ul)) * 0x9e3779b97f4a7c15ULL >> 32);
+    for (;; i++) {
+        i &= ERRMAP_MAX_WORDS - 1;
+        if (!m->words[i].count || m->words[i].offset == offset)
+            return &m->words[i];
+    }
+}
+
+int errmap_init(size_t size, size_t pagesize) {
+    memtester_errors.pagesize = pagesize;
+    memtester_errors.npages = (size + pagesize - 1) / pagesize;
+    memtester_errors.pages = calloc((memtester_errors.npages + 7) / 8, 1);
+    memtester_errors.words = calloc(ERRMAP_MAX_WORDS,
+                                    sizeof(memtester_bad_word));
+    return memtester_errors.pages && memtester_errors.words ? 0 : -1;
+}
+
+void errmap_record(const char *tname, size_t offset, ul expected, ul actual) {
+    memtester_errmap *m = &memtester_errors;
+    memtester_error *e;
+    memtester_bad_word *w;
+    size_t page;
+    ul diff = expected ^ actual;
+
+    if (memtester_focusing)
+        return;
+    evlog_event(EVLOG_MISMATCH, offset, expected, actual);
+    pthread_mutex_lock(&errmap_mutex);
+    m->nerrors++;
+    if (m->pages) {
+        page = offset / m->pagesize;
+        if (page < m->npages)
+            m->pages[page / 8] |= 1 << (page % 8);
+    }
+    if (m->nrecords < ERRMAP_MAX_RECORDS) {
+        e = &m->records[m->nrecords++];
+        e->offset = offset;
+        e->expected = expected;
+        e->actual = actual;
+        e->tname = tname;
+    }
+    w = find_word(offset);
+    if (w && !w->count && m->nwords >= ERRMAP_MAX_WORDS / 4 * 3)
+        w = NULL;
+    if (w) {
+        if (!w->count++) {
+            m->nwords++;
+            w->offset = offset;
+            w->first_test = tname;
+        }
+        w->flipped |= diff;
+        w->last_test = tname;
+    } else {
+        m->untracked++;
+    }
+    dram_record(offset, diff);
+    while (diff) {
+        m->bit_errors[__builtin_ctzl(diff)]++;
+        diff &= diff - 1;
+    }
+    pthread_mutex_unlock(&errmap_mutex);
+}
+
+ull errmap_word_count(size_t offset) {
+    memtester_bad_word *w;
+    ull count;
+
+    pthread_mutex_lock(&errmap_mutex);
+    w = find_word(offset);
+    count = w ? w->count : 0;
+    pthread_mutex_unlock(&errmap_mutex);
+    return count;
+}
+
+size_t errmap_bad_pages(void) {
+    size_t i, n = 0;
+
+    if (!memtester_errors.pages)
+        return 0;
+    for (i = 0; i < (memtester_errors.npages + 7) / 8; i++)
+        n += __builtin_popcount(memtester_errors.pages[i]);
+    return n;
+}
+
+/* The most frequent bad words.  Called with the mutex held. */
+static void print_words(FILE *f) {
+    memtester_errmap *m = &memtester_errors;
+    memtester_bad_word *w, *best;
+    ull limit = (ull) -1, phys;
+    size_t i, n;
+
+    fprintf(f, "  %llu bad words", (ull) m->nwords);
+    if (m->untracked)
+        fprintf(f, " (and %llu mismatches of untracked words)", m->untracked);
+    fprintf(f, ", the most frequent:\n");
+    /* Words with the same count are printed together. */
+    for (n = 0; n < ERRMAP_PRINT_WORDS && n < m->nwords;) {
+        best = NULL;
+        for (i = 0; i < ERRMAP_MAX_WORDS; i++) {
+            w = &m->words[i];
+            if (w->count && w->count < limit &&
+                (!best || w->count > best->count))
+                best = w;
+        }
+        if (!best)
+            break;
+        limit = best->count;
+        for (i = 0; i < ERRMAP_MAX_WORDS && n < ERRMAP_PRINT_WORDS; i++) {
+            w = &m->words[i];
+            if (w->count != limit)
+                continue;
+            fprintf(f, "    0x%08lx", (ul) w->offset);
+            if (dram_phys(w->offset, &phys) == 0)
+                fprintf(f, " (physical 0x%09llx)", phys);
+            fprintf(f, ": %llu times, bits 0x%08lx, %s", w->count,
+                    w->flipped, w->first_test);
+            if (w->last_test != w->first_test)
+                fprintf(f, " to %s", w->last_test);
+            fprintf(f, "\n");
+            n++;
+        }
+    }
+}
+
+void errmap_print(FILE *f) {
+    memtester_errmap *m = &memtester_errors;
+    unsigned int b;
+
+    pthread_mutex_lock(&errmap_mutex);
+    fprintf(f, "Error map: %llu mismatching words in %llu of %llu pages "
+            "(%llu recorded)\n", m->nerrors, (ull) errmap_bad_pages(),
+            (ull) m->npages, (ull) m->nrecords);
+    if (m->nerrors) {
+        fprintf(f, "  flipped bits:");
+        for (b = 0; b < ERRMAP_BITS; b++) {
+            if (m->bit_errors[b])
+                fprintf(f, " %u:%llu", b, m->bit_errors[b]);
+        }
+        fprintf(f, "\n");
+    }
+    if (m->nwords)
+        print_words(f);
+    pthread_mutex_unlock(&errmap_mutex);
+}
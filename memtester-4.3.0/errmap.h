@@ -0,0 +1,87 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the error map.
+ *
+ */
+
+#ifndef MEMTESTER_ERRMAP_H
+#define MEMTESTER_ERRMAP_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define ERRMAP_MAX_RECORDS 1024
+#define ERRMAP_BITS (sizeof(unsigned long) * 8)
+#define ERRMAP_MAX_WORDS 16384  /* distinct bad words, a power of 2 */
+#define ERRMAP_PRINT_WORDS 16   /* most frequent bad words printed */
+
+/*
+ * One mismatching word.  In the two buffer tests the value read from bufa
+ * is stored as 'actual' and the one from bufb as 'expected'.
+ */
+typedef struct memtester_error {
+    size_t offset;          /* bytes from the start of the tested region */
+    unsigned long expected;
+    unsigned long actual;
+    const char *tname;
+} memtester_error;
+
+/* A bad word and all its mismatches. */
+typedef struct memtester_bad_word {
+    size_t offset;
+    unsigned long long count;   /* 0 for an unused slot */
+    unsigned long flipped;      /* every bit seen flipped */
+    const char *first_test;
+    const char *last_test;
+} memtester_bad_word;
+
+/*
+ * Every mismatch found during the run: a bitmap of the pages holding at
+ * least one bad word, the first ERRMAP_MAX_RECORDS mismatches, the
+ * mismatches of each bad word (a hash table of ERRMAP_MAX_WORDS words, kept
+ * at most 3/4 full) and, for each bit of a word, how many mismatches had
+ * that bit flipped.
+ */
+typedef struct memtester_errmap {
+    unsigned char *pages;   /* one bit per page, NULL if not allocated */
+    size_t npages;
+    size_t pagesize;
+    memtester_error records[ERRMAP_MAX_RECORDS];
+    size_t nrecords;
+    unsigned long long nerrors; /* all mismatches, recorded or not */
+    unsigned long long bit_errors[ERRMAP_BITS];
+    memtester_bad_word *words;  /* NULL if not allocated */
+    size_t nwords;
+    unsigned long long untracked; /* mismatches of words not in the table */
+} memtester_errmap;
+
+extern memtester_errmap memtester_errors;
+
+/* Size the page bitmap for a region of 'size' bytes.  Returns 0 on success. */
+int errmap_init(size_t size, size_t pagesize);
+
+/* Add a mismatch to the map.  Safe to call from several workers at once. */
+void errmap_record(const char *tname, size_t offset, unsigned long expected,
+                   unsigned long actual);
+
+/* Number of mismatches seen at 'offset' so far. */
+unsigned long long errmap_word_count(size_t offset);
+
+/* Number of pages with at least one mismatch. */
+size_t errmap_bad_pages(void);
+
+/*
+ * Print a summary of the map, the per-bit histogram and the most frequent
+ * bad words.
+ */
+void errmap_print(FILE *f);
+
+#endif
@@ -0,0 +1,177 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the binary event log (MEMTESTER_EVENT_LOG).  The
+ * events are stored into a file mapped with MAP_SHARED, so logging one is
+ * a few stores without any syscall, and what was logged survives a crash
+ * of memtester.  A thread writes the log back to the disk with msync() at
+ * a bounded rate, so that it also survives a hung board being reset.  Use
+ * memtester-evlog to read it.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "types.h"
+#include "threads.h"
+#include "dram.h"
+#include "evlog.h"
+
+unsigned int evlog_interval = EVLOG_INTERVAL_DEFAULT;
+
+static evlog_header *header;
+static evlog_record *records;
+static size_t map_size;
+static int dirty;
+static uint32_t current_loop;
+static uint16_t current_test = EVLOG_NO_TEST;
+
+static pthread_mutex_t flush_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flush_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t flusher;
+static int flusher_running;
+static int flusher_quit;
+
+static void *flusher_main(void *arg) {
+    struct timespec ts;
+
+    (void) arg;
+    pthread_mutex_lock(&flush_mutex);
+    while (!flusher_quit) {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += (long) (evlog_interval % 1000) * 1000000;
+        ts.tv_sec += evlog_interval / 1000 + ts.tv_nsec / 1000000000;
+        ts.tv_nsec %= 1000000000;
+        pthread_cond_timedwait(&flush_cond, &flush_mutex, &ts);
+        if (__atomic_exchange_n(&dirty, 0, __ATOMIC_RELAXED))
+            msync(header, map_size, MS_SYNC);
+    }
+    pthread_mutex_unlock(&flush_mutex);
+    return NULL;
+}
+
+int evlog_open(const char *path, size_t nrecords, struct test *list) {
+    void *p;
+    int fd, i;
+
+    if (!nrecords)
+        return -1;
+    map_size = EVLOG_RECORDS_OFFSET + nrecords * sizeof(evlog_record);
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+    if (ftruncate(fd, map_size) != 0) {
+        close(fd);
+        return -1;
+    }
+    p = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return -1;
+
+    header = p;
+    records = (evlog_record *) ((char *) p + EVLOG_RECORDS_OFFSET);
+    memcpy(header->magic, EVLOG_MAGIC, sizeof(header->magic));
+    header->version = EVLOG_VERSION;
+    header->record_size = sizeof(evlog_record);
+    header->capacity = nrecords;
+    header->head = 0;
+    for (i = 0; list[i].name && i < EVLOG_MAX_TESTS; i++)
+        snprintf(header->tests[i], EVLOG_NAME_LEN, "%s", list[i].name);
+    header->ntests = i;
+    msync(header, map_size, MS_SYNC);
+
+    if (evlog_interval) {
+        flusher_quit = 0;
+        if (pthread_create(&flusher, NULL, flusher_main, NULL) == 0)
+            flusher_running = 1;
+    }
+    return 0;
+}
+
+int evlog_active(void) {
+    return header != NULL;
+}
+
+void evlog_event(unsigned int type, size_t offset, ull expected,
+                 ull actual) {
+    evlog_record *r;
+    struct timespec ts;
+    uint64_t n;
+    ull phys;
+
+    if (!header)
+        return;
+    n = __atomic_fetch_add(&header->head, 1, __ATOMIC_RELAXED);
+    r = &records[n % header->capacity];
+    __atomic_store_n(&r->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    clock_gettime(CLOCK_REALTIME, &ts);
+    r->time_ns = (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+    r->offset = offset;
+    /* The start, loop, test and end markers have no address. */
+    if (type == EVLOG_START || type == EVLOG_LOOP || type == EVLOG_TEST ||
+        type == EVLOG_END || dram_phys(offset, &phys) != 0)
+        phys = EVLOG_NO_PHYS;
+    r->phys = phys;
+    r->expected = expected;
+    r->actual = actual;
+    r->loop = current_loop;
+    r->type = type;
+    r->test = current_test;
+    r->thread = memtester_thread_id;
+    r->reserved = 0;
+    __atomic_store_n(&r->seq, n + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&dirty, 1, __ATOMIC_RELAXED);
+}
+
+void evlog_loop(ul loop) {
+    current_loop = loop;
+    current_test = EVLOG_NO_TEST;
+    evlog_event(EVLOG_LOOP, 0, 0, 0);
+}
+
+void evlog_test(int test) {
+    current_test = test < 0 ? EVLOG_NO_TEST : test;
+    evlog_event(EVLOG_TEST, 0, 0, 0);
+}
+
+unsigned int evlog_kind(const char *kind) {
+    if (strcmp(kind, "WRITE") == 0)
+        return EVLOG_WRITE;
+    if (strcmp(kind, "READ") == 0)
+        return EVLOG_READ;
+    if (strcmp(kind, "INTERMITTENT") == 0)
+        return EVLOG_INTERMITTENT;
+    return EVLOG_DISTURBANCE;
+}
+
+void evlog_close(void) {
+    if (!header)
+        return;
+    evlog_event(EVLOG_END, 0, 0, 0);
+    if (flusher_running) {
+        pthread_mutex_lock(&flush_mutex);
+        flusher_quit = 1;
+        pthread_cond_signal(&flush_cond);
+        pthread_mutex_unlock(&flush_mutex);
+        pthread_join(flusher, NULL);
+        flusher_running = 0;
+    }
+    msync(header, map_size, MS_SYNC);
+    munmap(header, map_size);
+    header = NULL;
+}
@@ -0,0 +1,104 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the format of the binary event log, shared with the
+ * decoder, and the declarations for writing it.
+ *
+ */
+
+#ifndef MEMTESTER_EVLOG_H
+#define MEMTESTER_EVLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EVLOG_MAGIC             "MTEVLOG1"
+#define EVLOG_VERSION           1
+#define EVLOG_MAX_TESTS         64
+#define EVLOG_NAME_LEN          24
+#define EVLOG_RECORDS_OFFSET    4096    /* the records follow the header */
+#define EVLOG_RECORDS_DEFAULT   65536
+#define EVLOG_INTERVAL_DEFAULT  1000    /* ms between two msync() */
+
+/* Event types. */
+#define EVLOG_START         1   /* expected: buffer size, actual: seed */
+#define EVLOG_LOOP          2
+#define EVLOG_TEST          3   /* a test starts */
+#define EVLOG_MISMATCH      4   /* one mismatching word */
+#define EVLOG_WRITE         5   /* failures, as classified on stderr */
+#define EVLOG_READ          6
+#define EVLOG_INTERMITTENT  7
+#define EVLOG_DISTURBANCE   8
+#define EVLOG_END           9
+
+#define EVLOG_NO_TEST       0xffff
+#define EVLOG_NO_PHYS       (~(uint64_t) 0)
+
+/*
+ * The file is a header, then a ring of 'capacity' records from offset
+ * EVLOG_RECORDS_OFFSET.  Event number n (from 0) is in slot n % capacity
+ * and is complete once its 'seq' is n + 1.  Little endian, fixed width
+ * fields, so that a log written on 32-bit ARM is read anywhere.
+ */
+typedef struct evlog_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;
+    uint64_t head;              /* events written so far */
+    uint32_t ntests;
+    uint32_t reserved;
+    char tests[EVLOG_MAX_TESTS][EVLOG_NAME_LEN];
+} evlog_header;
+
+typedef struct evlog_record {
+    uint64_t seq;
+    uint64_t time_ns;           /* CLOCK_REALTIME */
+    uint64_t offset;            /* bytes from the start of the buffer */
+    uint64_t phys;              /* EVLOG_NO_PHYS if unknown */
+    uint64_t expected;
+    uint64_t actual;
+    uint32_t loop;
+    uint16_t type;              /* EVLOG_* */
+    uint16_t test;              /* index in the test list */
+    uint32_t thread;            /* worker */
+    uint32_t reserved;
+} evlog_record;
+
+struct test;
+
+/* Interval between two msync() of the log, in milliseconds. */
+extern unsigned int evlog_interval;
+
+/*
+ * Create the log at 'path' with room for 'nrecords' events, naming the
+ * tests of 'list' in the header, and start the thread flushing it.
+ * Returns 0 on success.
+ */
+int evlog_open(const char *path, size_t nrecords, struct test *list);
+
+/* Non-zero once the log is open. */
+int evlog_active(void);
+
+/* Log an event.  Safe to call from the workers, without any syscall. */
+void evlog_event(unsigned int type, size_t offset, unsigned long long expected,
+                 unsigned long long actual);
+
+/* Log the start of a loop or of test 'test' of the list. */
+void evlog_loop(unsigned long loop);
+void evlog_test(int test);
+
+/* Event type of a failure kind as printed ("WRITE", "READ", ...). */
+unsigned int evlog_kind(const char *kind);
+
+/* Flush the log and stop the flushing thread. */
+void evlog_close(void);
+
+#endif
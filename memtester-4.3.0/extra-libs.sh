@@ -12,5 +12,7 @@ dgux-*) ;;
 hp-ux-*) ;;
 sco*) ;;
 *)
+  # the worker pool (-t) needs pthreads
+  echo -lpthread
   ;;
 esac
@@ -0,0 +1,150 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the focus mode (-F).  A marginal cell which failed
+ * once may not fail again before the next loop, tens of minutes later.
+ * After a failure, the failing test and all the other tests of the list
+ * are run over and over on a small window around the failing word, which
+ * takes milliseconds per run, to tell how reproducible the failure is and
+ * which is the cheapest pattern triggering it.
+ *
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "types.h"
+#include "threads.h"
+#include "kernels.h"
+#include "focus.h"
+
+int memtester_focus = 0;
+size_t memtester_focus_window = FOCUS_WINDOW_DEFAULT;
+double memtester_focus_seconds = FOCUS_SECONDS_DEFAULT;
+int memtester_focusing = 0;
+memtester_failure_t memtester_last_failure;
+
+struct focus_result {
+    ul runs;
+    ul failures;
+    ul same_word;       /* failures at the original word */
+    ul flipped;         /* bits seen flipped */
+    double first;       /* seconds to the first failure */
+};
+
+static double now(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + 0.000000001 * t.tv_nsec;
+}
+
+/*
+ * First word of a window of 'n' words around word 'index' of a region of
+ * 'count' words, kept aligned like the worker stripes.
+ */
+static size_t window_start(size_t index, size_t n, size_t count) {
+    size_t start = index > n / 2 ? index - n / 2 : 0;
+
+    if (start + n > count)
+        start = count - n;
+    return start & ~(size_t) 63;
+}
+
+void focus_run(struct test *list, int failed, ulv *bufa, ulv *bufb,
+               size_t count, size_t bufsize) {
+    struct focus_result results[MAX_TESTS] = { { 0 } };
+    struct focus_result *r;
+    memtester_failure_t origin = memtester_last_failure;
+    size_t index = origin.offset / sizeof(ul), n, start;
+    double t0, t, deadline;
+    int i, k, ntests, result, best = -1, mirrored = 0;
+    ul rounds = 0;
+
+    for (ntests = 0; list[ntests].name && ntests < MAX_TESTS; ntests++)
+        ;
+    printf("\n  focusing on offset 0x%08lx for %.0fs (%lukB window):\n",
+           (ul) origin.offset, memtester_focus_seconds,
+           (ul) (memtester_focus_window >> 10));
+    fflush(stdout);
+
+    memtester_focusing = 1;
+    t0 = now();
+    deadline = t0 + memtester_focus_seconds;
+    while ((t = now()) < deadline) {
+        /* The failing test first in every round. */
+        for (k = -1; k < ntests; k++) {
+            i = k < 0 ? failed : k;
+            if (k == failed)
+                continue;
+            if (list[i].flags & TEST_NEEDS_BUFB) {
+                n = memtester_focus_window / 2 / sizeof(ul);
+                if (n > count)
+                    n = count;
+                /* The same window every time, so the main loop's rule
+                   applies: copy only if the last test left it different. */
+                start = window_start(index < count ? index : index - count,
+                                     n, count);
+                if ((list[i].flags & TEST_NEEDS_MIRROR) && !mirrored)
+                    copy_region(bufb + start, bufa + start, n);
+                memtester_stripe_offset = start * sizeof(ul);
+                result = list[i].fp(bufa + start, bufb + start, n);
+                mirrored = !result && (list[i].flags & TEST_MIRRORS);
+            } else {
+                n = memtester_focus_window / sizeof(ul);
+                if (n > bufsize / sizeof(ul))
+                    n = bufsize / sizeof(ul);
+                start = window_start(index, n, bufsize / sizeof(ul));
+                memtester_stripe_offset = start * sizeof(ul);
+                result = list[i].fp(bufa + start, n);
+                mirrored = 0;
+            }
+            r = &results[i];
+            r->runs++;
+            if (result) {
+                if (!r->failures++)
+                    r->first = now() - t0;
+                r->flipped |= memtester_last_failure.flipped;
+                if (memtester_last_failure.offset == origin.offset)
+                    r->same_word++;
+            }
+        }
+        rounds++;
+    }
+    memtester_stripe_offset = 0;
+    memtester_focusing = 0;
+    t = now() - t0;
+
+    printf("  %-20s %8s %8s %10s %10s %s\n", "Test", "runs", "failed",
+           "same word", "first (s)", "bits flipped");
+    for (i = 0; i < ntests; i++) {
+        r = &results[i];
+        if (!r->runs)
+            continue;
+        printf("  %-20s %8lu %7.1f%% %10lu", list[i].name, r->runs,
+               100.0 * r->failures / r->runs, r->same_word);
+        if (r->failures)
+            printf(" %10.3f 0x%08lx", r->first, r->flipped);
+        printf("\n");
+        if (r->failures && (best < 0 || list[i].writes + list[i].reads <
+                                        list[best].writes + list[best].reads))
+            best = i;
+    }
+    if (best >= 0) {
+        printf("  %lu rounds (%.0f per second), the cheapest triggering "
+               "pattern is %s (%u passes per word)\n", rounds,
+               t > 0 ? rounds / t : 0, list[best].name,
+               list[best].writes + list[best].reads);
+    } else {
+        printf("  not reproduced in %lu rounds\n", rounds);
+    }
+    printf("\n");
+    fflush(stdout);
+}
@@ -0,0 +1,56 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the focus mode.
+ *
+ */
+
+#ifndef MEMTESTER_FOCUS_H
+#define MEMTESTER_FOCUS_H
+
+#include <stddef.h>
+
+#define FOCUS_WINDOW_DEFAULT    (1 << 20)
+#define FOCUS_SECONDS_DEFAULT   10
+
+struct test;
+
+/* Set by -F. */
+extern int memtester_focus;
+/* Bytes of memory around a failure re-tested by the focus mode. */
+extern size_t memtester_focus_window;
+/* Time spent on each failure, in seconds. */
+extern double memtester_focus_seconds;
+
+/*
+ * Non-zero while the focus mode runs.  Failures are then neither printed
+ * nor added to the error map, only noted in memtester_last_failure.
+ */
+extern int memtester_focusing;
+
+typedef struct memtester_failure_t {
+    size_t offset;      /* as passed to report_failure() */
+    unsigned long flipped;
+} memtester_failure_t;
+
+/* The last failure reported (or noted, while focusing). */
+extern memtester_failure_t memtester_last_failure;
+
+/*
+ * Re-run test 'failed' of 'list', which just failed at
+ * memtester_last_failure, and the other tests of the list on a window
+ * around the failure, for memtester_focus_seconds, and print how often
+ * each of them reproduced it.  'bufa', 'bufb' and 'count' are as passed to
+ * the two buffer tests, the single buffer tests get all of bufa.
+ */
+void focus_run(struct test *list, int failed, unsigned long volatile *bufa,
+               unsigned long volatile *bufb, size_t count, size_t bufsize);
+
+#endif
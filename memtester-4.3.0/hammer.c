@@ -0,0 +1,154 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the row hammer test (-H).  Reading two rows of the
+ * same bank over and over, with the cache lines flushed in between, opens
+ * and closes them hundreds of thousands of times per refresh interval,
+ * which can flip bits in the rows next to them on marginal DRAM.
+ *
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "types.h"
+#include "sizes.h"
+#include "memtester.h"
+#include "tests.h"
+#include "threads.h"
+#include "kernels.h"
+#include "errmap.h"
+#include "dram.h"
+#include "hammer.h"
+
+#define HAMMER_BLOCK 512    /* words compared at once when scanning */
+#define HAMMER_TRIES 64     /* attempts at finding a double-sided pair */
+
+int memtester_hammer = 0;
+unsigned long memtester_hammer_pairs = HAMMER_PAIRS_DEFAULT;
+unsigned long memtester_hammer_rounds = HAMMER_ROUNDS_DEFAULT;
+
+static double hammer_time(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Find the rows on both sides of a random victim row, in the same bank and
+ * both inside the buffer.  'a' and 'b' are word indexes.
+ */
+static int pick_double_sided(size_t count, size_t *a, size_t *b) {
+    const dram_geometry *g = memtester_dram;
+    dram_location loc;
+    ull phys;
+    size_t offset_a, offset_b;
+    int i;
+
+    if (!g || !g->encode)
+        return -1;
+    for (i = 0; i < HAMMER_TRIES; i++) {
+        if (dram_phys((rand_ul() % count) * sizeof(ul), &phys) != 0 ||
+            phys < g->base)
+            continue;
+        g->decode(g, phys, &loc);
+        if (loc.row == 0 || loc.row + 1 >= 1UL << g->row_bits)
+            continue;
+        loc.row--;
+        if (dram_offset(g->encode(g, &loc), &offset_a) != 0)
+            continue;
+        loc.row += 2;
+        if (dram_offset(g->encode(g, &loc), &offset_b) != 0)
+            continue;
+        if (offset_a / sizeof(ul) >= count || offset_b / sizeof(ul) >= count)
+            continue;
+        *a = offset_a / sizeof(ul);
+        *b = offset_b / sizeof(ul);
+        return 0;
+    }
+    return -1;
+}
+
+int hammer_supported(void) {
+#if defined(__arm__)
+    return use_phys;
+#else
+    return 1;
+#endif
+}
+
+int test_row_hammer(ulv *buf, size_t count) {
+    static unsigned int pass;
+    ul ref[HAMMER_BLOCK], p, v, first_value = 0;
+    size_t i, k, n, a, b, first = 0, nbad = 0;
+    unsigned long pair, double_sided = 0;
+    double t;
+
+    p = pass++ % 2 ? CHECKERBOARD2 : CHECKERBOARD1;
+    for (i = 0; i < HAMMER_BLOCK; i++) {
+        ref[i] = p;
+    }
+    for (i = 0; i < count; i += n) {
+        n = count - i < HAMMER_BLOCK ? count - i : HAMMER_BLOCK;
+        copy_region(buf + i, ref, n);
+    }
+
+    t = hammer_time();
+    for (pair = 0; pair < memtester_hammer_pairs; pair++) {
+        if (pick_double_sided(count, &a, &b) == 0) {
+            double_sided++;
+        } else {
+            a = rand_ul() % count;
+            b = rand_ul() % count;
+        }
+        hammer_pair_asm(buf + a, buf + b, memtester_hammer_rounds);
+    }
+    t = hammer_time() - t;
+    /* Only reads of double-sided pairs are known to open another row. */
+    printf("%lu pairs (%lu double-sided), %.1fM %s/s ",
+           memtester_hammer_pairs, double_sided,
+           t > 0 ? 2.0 * memtester_hammer_pairs * memtester_hammer_rounds /
+                   t / 1e6 : 0.0,
+           double_sided == memtester_hammer_pairs ? "activations" : "reads");
+    fflush(stdout);
+
+    for (i = 0; i < count; i += n) {
+        n = count - i < HAMMER_BLOCK ? count - i : HAMMER_BLOCK;
+        if (compare_regions_kernel(buf + i, (ulv *) ref, n, &v, &v) ==
+            (size_t)(-1))
+            continue;
+        for (k = i; k < i + n; k++) {
+            v = buf[k];
+            if (v == p)
+                continue;
+            errmap_record("row_hammer", k * sizeof(ul), p, v);
+            if (!nbad++) {
+                first = k;
+                first_value = v;
+            }
+        }
+    }
+    if (!nbad)
+        return 0;
+    report_failure("DISTURBANCE", "row_hammer", first * sizeof(ul),
+                   first_value, p);
+    if (nbad > 1) {
+        memtester_report_lock();
+        if (report_allowed((size_t) -1)) {
+            fprintf(stderr, "  ... and %llu more flipped words "
+                    "(row_hammer).\n", (ull) nbad - 1);
+        }
+        memtester_report_unlock();
+    }
+    return -1;
+}
@@ -0,0 +1,45 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the row hammer test.
+ *
+ */
+
+#ifndef MEMTESTER_HAMMER_H
+#define MEMTESTER_HAMMER_H
+
+#include <stddef.h>
+
+#define HAMMER_PAIRS_DEFAULT 16
+#define HAMMER_ROUNDS_DEFAULT 1000000
+
+/* Set by -H, the row hammer test then runs at the end of every loop. */
+extern int memtester_hammer;
+extern unsigned long memtester_hammer_pairs;   /* aggressor pairs per loop */
+extern unsigned long memtester_hammer_rounds;  /* reads of each pair */
+
+void hammer_pair_asm(void volatile *a, void volatile *b, unsigned long count);
+
+/*
+ * Non-zero if the aggressor reads can reach DRAM.  32-bit ARM cannot flush
+ * the caches from user space, so there the reads stay in the cache unless
+ * the memory is mapped uncached with -p.
+ */
+int hammer_supported(void);
+
+/*
+ * Fill the whole region with a pattern, hammer aggressor pairs and then
+ * look for flipped bits everywhere.  The pairs are double-sided (the rows
+ * above and below a victim row in the same bank) when the DRAM geometry
+ * is known, random otherwise.
+ */
+int test_row_hammer(unsigned long volatile *buf, size_t count);
+
+#endif
@@ -0,0 +1,535 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the pattern fill, copy, compare and divide kernels
+ * together with the runtime CPU feature dispatch.  The SIMD variants only
+ * handle whole blocks of 16 words; the remaining tail is always processed
+ * by the scalar code.
+ *
+ */
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86
+#include <immintrin.h>
+#endif
+#if defined(__arm__) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+#include "types.h"
+#include "kernels.h"
+
+#define BLOCK_WORDS 16
+
+/* Scalar implementations. */
+
+static void fill_regions_scalar(ulv *bufa, ulv *bufb, size_t count,
+                                ul even, ul odd) {
+    size_t i;
+
+    for (i = 0; i + 1 < count; i += 2) {
+        bufa[i] = bufb[i] = even;
+        bufa[i + 1] = bufb[i + 1] = odd;
+    }
+    if (i < count) {
+        bufa[i] = bufb[i] = even;
+    }
+}
+
+static size_t compare_regions_scalar(ulv *bufa, ulv *bufb, size_t count,
+                                     ul *va, ul *vb) {
+    size_t i, result = (size_t)(-1);
+    ulv *p1 = bufa;
+    ulv *p2 = bufb;
+
+    for (i = 0; i < count; i++, p1++, p2++) {
+        ul v1 = *p1, v2 = *p2;
+        if (v1 != v2) {
+            *va = v1;
+            *vb = v2;
+            result = i;
+        }
+    }
+    return result;
+}
+
+static void copy_region_scalar(ulv *dst, ulv *src, size_t count) {
+    memcpy((void *) dst, (void *) src, count * sizeof(ul));
+}
+
+/* Twice the width of ul, for the multiply-high. */
+#if ULONG_MAX > 0xffffffffUL
+typedef unsigned __int128 ul2;
+#else
+typedef unsigned long long ul2;
+#endif
+
+#define UL_BITS (sizeof(ul) * CHAR_BIT)
+
+/*
+ * With l = ceil(log2(q)), m = floor(2^N * (2^l - q) / q) + 1 fits in N bits
+ * and the quotient is exact for every N-bit dividend (Granlund and
+ * Montgomery, "Division by invariant integers using multiplication").
+ * q == 1 gives m == 1 and no shifts, a power of two gives m == 1 too.
+ */
+void divisor_init(memtester_divisor_t *d, ul q) {
+    unsigned int l = 0;
+
+    while (l < UL_BITS && ((ul) 1 << l) < q)
+        l++;
+    /* For l == N, 2^l - q wraps to the right value. */
+    d->m = (ul) ((((ul2) ((l < UL_BITS ? (ul) 1 << l : 0) - q)) << UL_BITS) / q
+                 + 1);
+    d->shift1 = l ? 1 : 0;
+    d->shift2 = l ? l - 1 : 0;
+}
+
+static inline ul divide(ul n, const memtester_divisor_t *d) {
+    ul t = (ul) (((ul2) n * d->m) >> UL_BITS);
+
+    return (t + ((n - t) >> d->shift1)) >> d->shift2;
+}
+
+static void div_regions_scalar(ulv *bufa, ulv *bufb, size_t count,
+                               const memtester_divisor_t *d) {
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        bufa[i] = divide(bufa[i], d);
+        bufb[i] = divide(bufb[i], d);
+    }
+}
+
+/* ARM NEON implementations, see arm-asm-helpers.S. */
+
+#ifdef __arm__
+typedef struct compare_regions_helper_result {
+    ul failed_index[8];
+    ul failed_value1[8];
+    ul failed_value2[8];
+} compare_regions_helper_result;
+
+void compare_regions_helper_neon(ulv *buf1, ulv *buf2, ul count,
+                                 compare_regions_helper_result *res);
+void fill_regions_helper_neon(ulv *buf1, ulv *buf2, ul count,
+                              ul even, ul odd);
+void copy_region_helper_neon(ulv *dst, ulv *src, ul count);
+void div_regions_helper_neon(ulv *buf1, ulv *buf2, ul count,
+                             const memtester_divisor_t *d);
+
+static size_t compare_regions_neon_blocks(ulv *bufa, ulv *bufb, size_t count,
+                                          ul *va, ul *vb) {
+    int j;
+    int best_j = 0;
+    compare_regions_helper_result res;
+
+    compare_regions_helper_neon(bufa, bufb, count, &res);
+    for (j = 0; j < 8; j++) {
+        if (res.failed_index[j] == 0xFFFFFFFF)
+            continue;
+        if (res.failed_index[best_j] == 0xFFFFFFFF)
+            best_j = j;
+        if (res.failed_index[j] > res.failed_index[best_j]) {
+            best_j = j;
+        }
+    }
+    if (res.failed_index[best_j] != 0xFFFFFFFF) {
+        *va = res.failed_value1[best_j];
+        *vb = res.failed_value2[best_j];
+        return res.failed_index[best_j];
+    }
+    return (size_t)(-1);
+}
+
+static void fill_regions_neon(ulv *bufa, ulv *bufb, size_t count,
+                              ul even, ul odd) {
+    size_t n = count & ~((size_t) BLOCK_WORDS - 1);
+
+    fill_regions_helper_neon(bufa, bufb, n, even, odd);
+    fill_regions_scalar(bufa + n, bufb + n, count - n, even, odd);
+}
+
+static void copy_region_neon(ulv *dst, ulv *src, size_t count) {
+    size_t n = count & ~((size_t) BLOCK_WORDS - 1);
+
+    copy_region_helper_neon(dst, src, n);
+    copy_region_scalar(dst + n, src + n, count - n);
+}
+
+static void div_regions_neon(ulv *bufa, ulv *bufb, size_t count,
+                             const memtester_divisor_t *d) {
+    size_t n = count & ~((size_t) BLOCK_WORDS - 1);
+
+    div_regions_helper_neon(bufa, bufb, n, d);
+    div_regions_scalar(bufa + n, bufb + n, count - n, d);
+}
+#endif
+
+/* x86 SSE2/AVX2 implementations. */
+
+#ifdef KERNELS_X86
+/* Two 128-bit lanes worth of the alternating pattern. */
+static void make_pattern(ul *pat, ul even, ul odd) {
+    size_t i;
+
+    for (i = 0; i < 32 / sizeof(ul); i += 2) {
+        pat[i] = even;
+        pat[i + 1] = odd;
+    }
+}
+
+__attribute__((target("sse2")))
+static void fill_regions_sse2(ulv *bufa, ulv *bufb, size_t count,
+                              ul even, ul odd) {
+    ul pat[32 / sizeof(ul)];
+    __m128i v;
+    __m128i *pa = (__m128i *) bufa, *pb = (__m128i *) bufb;
+    size_t i, n = count & ~((size_t) BLOCK_WORDS - 1);
+
+    make_pattern(pat, even, odd);
+    v = _mm_loadu_si128((__m128i *) pat);
+    for (i = 0; i < n * sizeof(ul) / 16; i += 4) {
+        _mm_storeu_si128(pa + i, v);
+        _mm_storeu_si128(pa + i + 1, v);
+        _mm_storeu_si128(pa + i + 2, v);
+        _mm_storeu_si128(pa + i + 3, v);
+        _mm_storeu_si128(pb + i, v);
+        _mm_storeu_si128(pb + i + 1, v);
+        _mm_storeu_si128(pb + i + 2, v);
+        _mm_storeu_si128(pb + i + 3, v);
+    }
+    fill_regions_scalar(bufa + n, bufb + n, count - n, even, odd);
+}
+
+__attribute__((target("sse2")))
+static size_t compare_regions_sse2_blocks(ulv *bufa, ulv *bufb, size_t count,
+                                          ul *va, ul *vb) {
+    __m128i *pa = (__m128i *) bufa, *pb = (__m128i *) bufb;
+    size_t i, idx, result = (size_t)(-1);
+    size_t n = count & ~((size_t) BLOCK_WORDS - 1);
+    const size_t vec_per_block = BLOCK_WORDS * sizeof(ul) / 16;
+
+    for (i = 0; i < n * sizeof(ul) / 16; i += vec_per_block) {
+        size_t k;
+        __m128i eq = _mm_set1_epi8(-1);
+        for (k = 0; k < vec_per_block; k++) {
+            eq = _mm_and_si128(eq, _mm_cmpeq_epi8(_mm_loadu_si128(pa + i + k),
+                                                  _mm_loadu_si128(pb + i + k)));
+        }
+        if (_mm_movemask_epi8(eq) != 0xFFFF) {
+            /* Slow path, only taken for the blocks with a mismatch. */
+            idx = compare_regions_scalar(bufa + i * 16 / sizeof(ul),
+                                         bufb + i * 16 / sizeof(ul),
+                                         BLOCK_WORDS, va, vb);
+            if (idx != (size_t)(-1))
+                result = i * 16 / sizeof(ul) + idx;
+        }
+    }
+    return result;
+}
+
+__attribute__((target("avx2")))
+static void fill_regions_avx2(ulv *bufa, ulv *bufb, size_t count,
+                              ul even, ul odd) {
+    ul pat[32 / sizeof(ul)];
+    __m256i v;
+    __m256i *pa = (__m256i *) bufa, *pb = (__m256i *) bufb;
+    size_t i, n = count & ~((size_t) BLOCK_WORDS - 1);
+
+    make_pattern(pat, even, odd);
+    v = _mm256_loadu_si256((__m256i *) pat);
+    for (i = 0; i < n * sizeof(ul) / 32; i += 2) {
+        _mm256_storeu_si256(pa + i, v);
+        _mm256_storeu_si256(pa + i + 1, v);
+        _mm256_storeu_si256(pb + i, v);
+        _mm256_storeu_si256(pb + i + 1, v);
+    }
+    fill_regions_scalar(bufa + n, bufb + n, count - n, even, odd);
+}
+
+__attribute__((target("avx2")))
+static size_t compare_regions_avx2_blocks(ulv *bufa, ulv *bufb, size_t count,
+                                          ul *va, ul *vb) {
+    __m256i *pa = (__m256i *) bufa, *pb = (__m256i *) bufb;
+    size_t i, idx, result = (size_t)(-1);
+    size_t n = count & ~((size_t) BLOCK_WORDS - 1);
+    const size_t vec_per_block = BLOCK_WORDS * sizeof(ul) / 32;
+
+    for (i = 0; i < n * sizeof(ul) / 32; i += vec_per_block) {
+        size_t k;
+        __m256i eq = _mm256_set1_epi8(-1);
+        for (k = 0; k < vec_per_block; k++) {
+            eq = _mm256_and_si256(eq,
+                    _mm256_cmpeq_epi8(_mm256_loadu_si256(pa + i + k),
+                                      _mm256_loadu_si256(pb + i + k)));
+        }
+        if (_mm256_movemask_epi8(eq) != -1) {
+            /* Slow path, only taken for the blocks with a mismatch. */
+            idx = compare_regions_scalar(bufa + i * 32 / sizeof(ul),
+                                         bufb + i * 32 / sizeof(ul),
+                                         BLOCK_WORDS, va, vb);
+            if (idx != (size_t)(-1))
+                result = i * 32 / sizeof(ul) + idx;
+        }
+    }
+    return result;
+}
+
+#if ULONG_MAX == 0xffffffffUL
+/* n / q for four words, see divide(). */
+__attribute__((target("sse2")))
+static inline __m128i divide_sse2(__m128i n, __m128i m, __m128i shift1,
+                                  __m128i shift2) {
+    const __m128i odd_lanes = _mm_set_epi32(-1, 0, -1, 0);
+    /* _mm_mul_epu32 only multiplies the even lanes. */
+    __m128i even = _mm_srli_epi64(_mm_mul_epu32(n, m), 32);
+    __m128i odd = _mm_and_si128(_mm_mul_epu32(_mm_srli_epi64(n, 32), m),
+                                odd_lanes);
+    __m128i t = _mm_or_si128(even, odd);
+
+    return _mm_srl_epi32(_mm_add_epi32(t, _mm_srl_epi32(_mm_sub_epi32(n, t),
+                                                        shift1)), shift2);
+}
+
+__attribute__((target("sse2")))
+static void div_regions_sse2(ulv *bufa, ulv *bufb, size_t count,
+                             const memtester_divisor_t *d) {
+    __m128i *pa = (__m128i *) bufa, *pb = (__m128i *) bufb;
+    __m128i m = _mm_set1_epi32((int) d->m);
+    __m128i shift1 = _mm_cvtsi32_si128((int) d->shift1);
+    __m128i shift2 = _mm_cvtsi32_si128((int) d->shift2);
+    size_t i, n = count & ~((size_t) BLOCK_WORDS - 1);
+
+    for (i = 0; i < n * sizeof(ul) / 16; i++) {
+        _mm_storeu_si128(pa + i, divide_sse2(_mm_loadu_si128(pa + i), m,
+                                             shift1, shift2));
+        _mm_storeu_si128(pb + i, divide_sse2(_mm_loadu_si128(pb + i), m,
+                                             shift1, shift2));
+    }
+    div_regions_scalar(bufa + n, bufb + n, count - n, d);
+}
+#else
+/*
+ * Neither SSE2 nor AVX2 has a 64-bit multiply-high, and the scalar one is
+ * a single instruction, so the 64-bit builds keep the scalar kernel.
+ */
+#define div_regions_sse2 div_regions_scalar
+#endif
+
+/*
+ * Streaming stores need 16-byte aligned destinations, the buffers are page
+ * aligned but fall back to the cached kernels for anything else.
+ */
+__attribute__((target("sse2")))
+static void fill_regions_sse2_nt(ulv *bufa, ulv *bufb, size_t count,
+                                 ul even, ul odd) {
+    ul pat[32 / sizeof(ul)];
+    __m128i v;
+    __m128i *pa = (__m128i *) bufa, *pb = (__m128i *) bufb;
+    size_t i, n = count & ~((size_t) BLOCK_WORDS - 1);
+
+    if (((size_t) bufa | (size_t) bufb) & 15) {
+        fill_regions_sse2(bufa, bufb, count, even, odd);
+        return;
+    }
+    make_pattern(pat, even, odd);
+    v = _mm_loadu_si128((__m128i *) pat);
+    for (i = 0; i < n * sizeof(ul) / 16; i += 4) {
+        _mm_stream_si128(pa + i, v);
+        _mm_stream_si128(pa + i + 1, v);
+        _mm_stream_si128(pa + i + 2, v);
+        _mm_stream_si128(pa + i + 3, v);
+        _mm_stream_si128(pb + i, v);
+        _mm_stream_si128(pb + i + 1, v);
+        _mm_stream_si128(pb + i + 2, v);
+        _mm_stream_si128(pb + i + 3, v);
+    }
+    _mm_sfence();
+    fill_regions_scalar(bufa + n, bufb + n, count - n, even, odd);
+}
+
+__attribute__((target("sse2")))
+static void copy_region_sse2_nt(ulv *dst, ulv *src, size_t count) {
+    __m128i *pd = (__m128i *) dst, *ps = (__m128i *) src;
+    size_t i, n = count & ~((size_t) BLOCK_WORDS - 1);
+
+    if ((size_t) dst & 15) {
+        copy_region_scalar(dst, src, count);
+        return;
+    }
+    for (i = 0; i < n * sizeof(ul) / 16; i += 4) {
+        _mm_stream_si128(pd + i, _mm_loadu_si128(ps + i));
+        _mm_stream_si128(pd + i + 1, _mm_loadu_si128(ps + i + 1));
+        _mm_stream_si128(pd + i + 2, _mm_loadu_si128(ps + i + 2));
+        _mm_stream_si128(pd + i + 3, _mm_loadu_si128(ps + i + 3));
+    }
+    _mm_sfence();
+    copy_region_scalar(dst + n, src + n, count - n);
+}
+#endif
+
+/* AArch64 streaming stores. */
+
+#ifdef __aarch64__
+static void fill_regions_stnp(ulv *bufa, ulv *bufb, size_t count,
+                              ul even, ul odd) {
+    size_t i, n = count & ~((size_t) 1);
+
+    for (i = 0; i < n; i += 2) {
+        __asm__ volatile("stnp %1, %2, [%0]"
+                         :: "r" (bufa + i), "r" (even), "r" (odd) : "memory");
+        __asm__ volatile("stnp %1, %2, [%0]"
+                         :: "r" (bufb + i), "r" (even), "r" (odd) : "memory");
+    }
+    __asm__ volatile("dmb ishst" ::: "memory");
+    fill_regions_scalar(bufa + n, bufb + n, count - n, even, odd);
+}
+
+static void copy_region_stnp(ulv *dst, ulv *src, size_t count) {
+    size_t i, n = count & ~((size_t) 1);
+
+    for (i = 0; i < n; i += 2) {
+        __asm__ volatile("stnp %1, %2, [%0]"
+                         :: "r" (dst + i), "r" (src[i]), "r" (src[i + 1])
+                         : "memory");
+    }
+    __asm__ volatile("dmb ishst" ::: "memory");
+    copy_region_scalar(dst + n, src + n, count - n);
+}
+#endif
+
+/*
+ * The SIMD compare helpers only look at whole blocks, check the tail here.
+ * It holds the highest indexes, so a mismatch there wins.
+ */
+#define DEFINE_COMPARE_WITH_TAIL(name, blocks)                              \
+static size_t name(ulv *bufa, ulv *bufb, size_t count, ul *va, ul *vb) {    \
+    size_t n = count & ~((size_t) BLOCK_WORDS - 1);                         \
+    size_t tail, result = (size_t)(-1);                                     \
+                                                                            \
+    if (n)                                                                  \
+        result = blocks(bufa, bufb, n, va, vb);                             \
+    tail = compare_regions_scalar(bufa + n, bufb + n, count - n, va, vb);   \
+    if (tail != (size_t)(-1))                                               \
+        result = n + tail;                                                  \
+    return result;                                                          \
+}
+
+#ifdef __arm__
+DEFINE_COMPARE_WITH_TAIL(compare_regions_neon, compare_regions_neon_blocks)
+#endif
+#ifdef KERNELS_X86
+DEFINE_COMPARE_WITH_TAIL(compare_regions_sse2, compare_regions_sse2_blocks)
+DEFINE_COMPARE_WITH_TAIL(compare_regions_avx2, compare_regions_avx2_blocks)
+#endif
+
+/* Runtime dispatch. */
+
+static const memtester_kernels_t kernels_scalar = {
+    "scalar", fill_regions_scalar, compare_regions_scalar, copy_region_scalar,
+    div_regions_scalar
+};
+
+#ifdef __arm__
+static const memtester_kernels_t kernels_neon = {
+    "neon", fill_regions_neon, compare_regions_neon, copy_region_neon,
+    div_regions_neon
+};
+#endif
+
+#ifdef KERNELS_X86
+static const memtester_kernels_t kernels_sse2 = {
+    "sse2", fill_regions_sse2, compare_regions_sse2, copy_region_scalar,
+    div_regions_sse2
+};
+static const memtester_kernels_t kernels_avx2 = {
+    "avx2", fill_regions_avx2, compare_regions_avx2, copy_region_scalar,
+    div_regions_sse2
+};
+static const memtester_kernels_t kernels_sse2_nt = {
+    "sse2-nt", fill_regions_sse2_nt, compare_regions_sse2,
+    copy_region_sse2_nt, div_regions_sse2
+};
+static const memtester_kernels_t kernels_avx2_nt = {
+    "avx2-nt", fill_regions_sse2_nt, compare_regions_avx2,
+    copy_region_sse2_nt, div_regions_sse2
+};
+#endif
+
+#ifdef __aarch64__
+static const memtester_kernels_t kernels_stnp = {
+    "stnp", fill_regions_stnp, compare_regions_scalar, copy_region_stnp,
+    div_regions_scalar
+};
+#endif
+
+/* Usable before kernels_init() is called, e.g. by the unit tests. */
+memtester_kernels_t memtester_kernels = {
+    "scalar", fill_regions_scalar, compare_regions_scalar, copy_region_scalar,
+    div_regions_scalar
+};
+memtester_kernels_t memtester_kernels_streaming = {
+    "scalar", fill_regions_scalar, compare_regions_scalar, copy_region_scalar,
+    div_regions_scalar
+};
+
+/* What kernels_set_streaming(0) goes back to. */
+static memtester_kernels_t kernels_cached = {
+    "scalar", fill_regions_scalar, compare_regions_scalar, copy_region_scalar,
+    div_regions_scalar
+};
+
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+
+int cpu_has_neon(void) {
+#if defined(__arm__) && defined(__linux__)
+    return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#else
+    return 0;
+#endif
+}
+
+void kernels_init(int verbose) {
+    memtester_kernels = kernels_scalar;
+    memtester_kernels_streaming = kernels_scalar;
+#ifdef __aarch64__
+    memtester_kernels_streaming = kernels_stnp;
+#endif
+#ifdef __arm__
+    if (cpu_has_neon()) {
+        memtester_kernels = kernels_neon;
+        memtester_kernels_streaming = kernels_neon;
+    }
+#endif
+#ifdef KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        memtester_kernels = kernels_avx2;
+        memtester_kernels_streaming = kernels_avx2_nt;
+    } else if (__builtin_cpu_supports("sse2")) {
+        memtester_kernels = kernels_sse2;
+        memtester_kernels_streaming = kernels_sse2_nt;
+    }
+#endif
+    kernels_cached = memtester_kernels;
+    if (verbose)
+        printf("using %s fill/copy/compare kernels\n", memtester_kernels.name);
+}
+
+void kernels_set_streaming(int on) {
+    memtester_kernels = on ? memtester_kernels_streaming : kernels_cached;
+}
@@ -0,0 +1,96 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the pattern fill, copy, compare
+ * and divide kernels used by the tests.  Each of them has a scalar
+ * implementation and SIMD implementations (NEON on ARM, SSE2/AVX2 on x86).
+ * The best one for the CPU we are running on is picked at startup by
+ * kernels_init().
+ *
+ */
+
+#ifndef MEMTESTER_KERNELS_H
+#define MEMTESTER_KERNELS_H
+
+#include <stddef.h>
+
+/*
+ * Unsigned division by a fixed 'q' done as a multiply and two shifts:
+ * n / q == (t + ((n - t) >> shift1)) >> shift2 with t the high half of
+ * m * n.  This gives the exact quotient for every n and every q >= 1, and
+ * avoids the libgcc division call on the cores without a divide
+ * instruction (Cortex-A8/A9).
+ */
+typedef struct memtester_divisor_t {
+    unsigned long m;
+    unsigned int shift1, shift2;
+} memtester_divisor_t;
+
+/* Precompute the multiplier and shifts for dividing by 'q' (q >= 1). */
+void divisor_init(memtester_divisor_t *d, unsigned long q);
+
+typedef struct memtester_kernels_t {
+    const char *name;
+    /*
+     * Fill 'count' words of both buffers with 'even' at the even indexes
+     * and 'odd' at the odd indexes.  Passing the same value twice gives a
+     * solid fill.
+     */
+    void (*fill)(unsigned long volatile *bufa, unsigned long volatile *bufb,
+                 size_t count, unsigned long even, unsigned long odd);
+    /*
+     * Compare 'count' words of both buffers.  Returns the index of the
+     * *last* mismatch (storing the two values read) or (size_t)(-1) if the
+     * buffers are identical.
+     */
+    size_t (*compare)(unsigned long volatile *bufa,
+                      unsigned long volatile *bufb, size_t count,
+                      unsigned long *va, unsigned long *vb);
+    /* Copy 'count' words from 'src' to 'dst'. */
+    void (*copy)(unsigned long volatile *dst, unsigned long volatile *src,
+                 size_t count);
+    /* Divide 'count' words of both buffers in place by the divisor. */
+    void (*div)(unsigned long volatile *bufa, unsigned long volatile *bufb,
+                size_t count, const memtester_divisor_t *d);
+} memtester_kernels_t;
+
+/* The implementations selected by kernels_init(). */
+extern memtester_kernels_t memtester_kernels;
+
+/*
+ * The same with streaming (non-temporal) stores for fill and copy, which
+ * write around the caches: MOVNTDQ on x86, STNP on AArch64.  32-bit ARM
+ * has no such stores, there these are the normal kernels.
+ */
+extern memtester_kernels_t memtester_kernels_streaming;
+
+/* Bind the streaming kernels (or back the cached ones) to the macros. */
+void kernels_set_streaming(int on);
+
+/*
+ * Probe the CPU features (AT_HWCAP on ARM, cpuid on x86) and bind the
+ * fastest kernels.  Safe to call more than once.  When 'verbose' is set,
+ * the chosen implementation is printed.
+ */
+void kernels_init(int verbose);
+
+/* Non-zero if the CPU supports the NEON instruction set. */
+int cpu_has_neon(void);
+
+#define fill_regions(bufa, bufb, count, even, odd) \
+    memtester_kernels.fill(bufa, bufb, count, even, odd)
+#define compare_regions_kernel(bufa, bufb, count, va, vb) \
+    memtester_kernels.compare(bufa, bufb, count, va, vb)
+#define copy_region(dst, src, count) \
+    memtester_kernels.copy(dst, src, count)
+#define div_regions(bufa, bufb, count, d) \
+    memtester_kernels.div(bufa, bufb, count, d)
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains memtester-evlog, which prints the binary event log
+ * written with MEMTESTER_EVENT_LOG as text or CSV, e.g. after the board
+ * was reset.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "evlog.h"
+
+static const char *type_names[] = {
+    "?", "START", "LOOP", "TEST", "MISMATCH", "WRITE", "READ",
+    "INTERMITTENT", "DISTURBANCE", "END"
+};
+
+static const char *type_name(unsigned int type) {
+    return type < sizeof(type_names) / sizeof(type_names[0])
+           ? type_names[type] : "?";
+}
+
+static const char *test_name(const evlog_header *h, unsigned int test) {
+    return test < h->ntests && test < EVLOG_MAX_TESTS ? h->tests[test] : "";
+}
+
+static void print_text(const evlog_header *h, const evlog_record *r) {
+    char when[32];
+    time_t sec = (time_t) (r->time_ns / 1000000000);
+    struct tm tm;
+
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", gmtime_r(&sec, &tm));
+    printf("%s.%06lu loop %lu %-8s %s", when,
+           (unsigned long) (r->time_ns % 1000000000 / 1000),
+           (unsigned long) r->loop, type_name(r->type),
+           test_name(h, r->test));
+    switch (r->type) {
+        case EVLOG_START:
+            printf(" %lluMB seed 0x%016llx",
+                   (unsigned long long) r->expected >> 20,
+                   (unsigned long long) r->actual);
+            break;
+        case EVLOG_MISMATCH:
+        case EVLOG_WRITE:
+        case EVLOG_READ:
+        case EVLOG_INTERMITTENT:
+        case EVLOG_DISTURBANCE:
+            printf(" offset 0x%08llx", (unsigned long long) r->offset);
+            if (r->phys != EVLOG_NO_PHYS)
+                printf(" phys 0x%09llx", (unsigned long long) r->phys);
+            printf(" expected 0x%016llx actual 0x%016llx bits 0x%016llx "
+                   "thread %lu", (unsigned long long) r->expected,
+                   (unsigned long long) r->actual,
+                   (unsigned long long) (r->expected ^ r->actual),
+                   (unsigned long) r->thread);
+            break;
+    }
+    printf("\n");
+}
+
+static void print_csv(const evlog_header *h, const evlog_record *r) {
+    printf("%llu,%llu,%lu,%s,\"%s\",%llu,", (unsigned long long) r->seq - 1,
+           (unsigned long long) r->time_ns, (unsigned long) r->loop,
+           type_name(r->type), test_name(h, r->test),
+           (unsigned long long) r->offset);
+    if (r->phys != EVLOG_NO_PHYS)
+        printf("%llu", (unsigned long long) r->phys);
+    printf(",0x%llx,0x%llx,%lu\n", (unsigned long long) r->expected,
+           (unsigned long long) r->actual, (unsigned long) r->thread);
+}
+
+static void usage(const char *me) {
+    fprintf(stderr, "Usage: %s [-c] <event log>\n"
+            "  -c  print CSV instead of text\n", me);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    evlog_header h;
+    evlog_record r;
+    FILE *f;
+    unsigned long long n, first, torn = 0;
+    int opt, csv = 0;
+
+    while ((opt = getopt(argc, argv, "c")) != -1) {
+        switch (opt) {
+            case 'c':
+                csv = 1;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1)
+        usage(argv[0]);
+    if (!(f = fopen(argv[optind], "rb"))) {
+        perror(argv[optind]);
+        return 1;
+    }
+    if (fread(&h, sizeof(h), 1, f) != 1 ||
+        memcmp(h.magic, EVLOG_MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != EVLOG_VERSION || h.record_size != sizeof(r) ||
+        !h.capacity) {
+        fprintf(stderr, "%s: not a memtester event log\n", argv[optind]);
+        return 1;
+    }
+
+    /* Only the last 'capacity' events are left in the ring. */
+    first = h.head > h.capacity ? h.head - h.capacity : 0;
+    if (first)
+        fprintf(stderr, "%llu older events were overwritten\n", first);
+    if (csv)
+        printf("event,time_ns,loop,type,test,offset,phys,expected,actual,"
+               "thread\n");
+    for (n = first; n < h.head; n++) {
+        if (fseek(f, EVLOG_RECORDS_OFFSET + (n % h.capacity) * sizeof(r),
+                  SEEK_SET) != 0 || fread(&r, sizeof(r), 1, f) != 1 ||
+            r.seq != n + 1) {
+            /* Interrupted while being written, or never written back. */
+            torn++;
+            continue;
+        }
+        if (csv)
+            print_csv(&h, &r);
+        else
+            print_text(&h, &r);
+    }
+    if (torn)
+        fprintf(stderr, "%llu incomplete events skipped\n", torn);
+    fclose(f);
+    return 0;
+}
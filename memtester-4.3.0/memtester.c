@@ -24,38 +24,93 @@
 #include <fcntl.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
+#include <fnmatch.h>
 
 #include "types.h"
 #include "sizes.h"
 #include "tests.h"
+#include "memtester.h"
+#include "threads.h"
+#include "kernels.h"
+#include "prng.h"
+#include "alloc.h"
+#include "errmap.h"
+#include "pagemap.h"
+#include "dram.h"
+#include "hammer.h"
+#include "progress.h"
+#include "stats.h"
+#include "sched.h"
+#include "focus.h"
+#include "evlog.h"
+#include "order.h"
 
 #define EXIT_FAIL_NONSTARTER    0x01
 #define EXIT_FAIL_ADDRESSLINES  0x02
 #define EXIT_FAIL_OTHERTEST     0x04
 
+/* How far (in bytes of both buffers) the verify trails the writes with -P,
+   comfortably more than the L2 cache of the boards we care about. */
+#define PIPELINE_LAG_DEFAULT    (4 << 20)
+
+/* Writes and reads of test_stuck_address(), in passes over the buffer. */
+#define STUCK_ADDRESS_PASSES    32
+
+/* Shorthands for the flags of the test list, BOTH writes both buffers alike. */
+#define BOTH    (TEST_NEEDS_BUFB | TEST_MIRRORS)
+#define RMW     (BOTH | TEST_NEEDS_MIRROR)
+
+/*
+ * The test registry: name, function, writes and reads per run (in passes
+ * over the whole region) and TEST_* flags.  At most MAX_TESTS per list.
+ */
 struct test tests[] = {
-    { "Random Value", test_random_value },
-    { "Compare XOR", test_xor_comparison },
-    { "Compare SUB", test_sub_comparison },
-    { "Compare MUL", test_mul_comparison },
-    { "Compare DIV",test_div_comparison },
-    { "Compare OR", test_or_comparison },
-    { "Compare AND", test_and_comparison },
-    { "Sequential Increment", test_seqinc_comparison },
-    { "Solid Bits", test_solidbits_comparison },
-    { "Block Sequential", test_blockseq_comparison },
-    { "Checkerboard", test_checkerboard_comparison },
-    { "Bit Spread", test_bitspread_comparison },
-    { "Bit Flip", test_bitflip_comparison },
-    { "Walking Ones", test_walkbits1_comparison },
-    { "Walking Zeroes", test_walkbits0_comparison },
+    { "Random Value", test_random_value, 1, 1, BOTH },
+    { "Compare XOR", test_xor_comparison, 1, 2, RMW },
+    { "Compare SUB", test_sub_comparison, 1, 2, RMW },
+    { "Compare MUL", test_mul_comparison, 1, 2, RMW },
+    { "Compare DIV", test_div_comparison, 1, 2, RMW },
+    { "Compare OR", test_or_comparison, 1, 2, RMW },
+    { "Compare AND", test_and_comparison, 1, 2, RMW },
+    { "Sequential Increment", test_seqinc_comparison, 1, 1, BOTH },
+    { "Solid Bits", test_solidbits_comparison, 64, 64, BOTH },
+    { "Block Sequential", test_blockseq_comparison, 256, 256, BOTH },
+    { "Checkerboard", test_checkerboard_comparison, 64, 64, BOTH },
+    { "Bit Spread", test_bitspread_comparison, UL_LEN * 2, UL_LEN * 2, BOTH },
+    { "Bit Flip", test_bitflip_comparison, UL_LEN * 8, UL_LEN * 8, BOTH },
+    { "Walking Ones", test_walkbits1_comparison,
+      UL_LEN * 2, UL_LEN * 2, BOTH },
+    { "Walking Zeroes", test_walkbits0_comparison,
+      UL_LEN * 2, UL_LEN * 2, BOTH },
 #ifdef TEST_NARROW_WRITES    
-    { "8-bit Writes", test_8bit_wide_random },
-    { "16-bit Writes", test_16bit_wide_random },
+    { "8-bit Writes", test_8bit_wide_random, 2, 2, BOTH },
+    { "16-bit Writes", test_16bit_wide_random, 2, 2, BOTH },
 #endif
-    { NULL, NULL }
+    { "Moving Inversions", test_movinv_comparison, 30, 20, BOTH },
+    /* The phase of the pattern follows the offset, bufb ends up different. */
+    { "Modulo 20", test_modulo20_comparison, 40, 40, TEST_NEEDS_BUFB },
+    { NULL, NULL, 0, 0, 0 }
 };
 
+/* Tests used with -S, see the comment above SINGLE_BUFFER_TEST in tests.c */
+struct test tests_single[] = {
+    { "Random Value", test_random_value_single, 1, 1, 0 },
+    { "Solid Bits", test_solidbits_single, 64, 64, 0 },
+    { "Block Sequential", test_blockseq_single, 256, 256, 0 },
+    { "Checkerboard", test_checkerboard_single, 64, 64, 0 },
+    { "Bit Spread", test_bitspread_single, UL_LEN * 2, UL_LEN * 2, 0 },
+    { "Bit Flip", test_bitflip_single, UL_LEN * 8, UL_LEN * 8, 0 },
+    { "Walking Ones", test_walkbits1_single, UL_LEN * 2, UL_LEN * 2, 0 },
+    { "Walking Zeroes", test_walkbits0_single, UL_LEN * 2, UL_LEN * 2, 0 },
+    { "Moving Inversions", test_movinv_single, 30, 20, 0 },
+    { "Modulo 20", test_modulo20_single, 40, 40, 0 },
+    { NULL, NULL, 0, 0, 0 }
+};
+
+#undef BOTH
+#undef RMW
+
 /* Sanity checks and portability helper macros. */
 #ifdef _SC_VERSION
 void check_posix_system(void) {
@@ -95,6 +150,102 @@ int memtester_pagesize(void) {
 /* Function declarations */
 void usage(char *me);
 
+static double monotonic_time(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + 0.000000001 * t.tv_nsec;
+}
+
+/*
+ * Mask of the tests in 'list' whose name matches one of the comma
+ * separated glob patterns in 'spec', e.g. "Compare *,Solid Bits".  Returns
+ * 0 if a pattern matches no test.
+ */
+static ull select_tests(struct test *list, const char *spec) {
+    char pattern[64];
+    const char *end;
+    size_t len;
+    ull mask = 0, matched;
+    int i;
+
+    for (; *spec; spec = *end ? end + 1 : end) {
+        end = strchr(spec, ',');
+        if (!end)
+            end = spec + strlen(spec);
+        len = end - spec;
+        if (len >= sizeof(pattern))
+            len = sizeof(pattern) - 1;
+        memcpy(pattern, spec, len);
+        pattern[len] = '\0';
+        matched = 0;
+        for (i = 0; list[i].name; i++) {
+            if (fnmatch(pattern, list[i].name, 0) == 0)
+                matched |= 1ULL << i;
+        }
+        if (!matched) {
+            fprintf(stderr, "no test matches \"%s\", the tests are:\n",
+                    pattern);
+            for (i = 0; list[i].name; i++)
+                fprintf(stderr, "  %s\n", list[i].name);
+            return 0;
+        }
+        mask |= matched;
+    }
+    return mask;
+}
+
+/* One write and one read pass with the SIMD kernels, to time the memory. */
+static int calibration_pass(ulv *bufa, ulv *bufb, size_t count) {
+    ul va, vb;
+
+    fill_regions(bufa, bufb, count, 0, UL_ONEBITS);
+    compare_regions_kernel(bufa, bufb, count, &va, &vb);
+    return 0;
+}
+
+/*
+ * Print the cost of the selected tests and an estimate of the time per
+ * loop, from the bandwidth of a calibration pass over (up to) the first
+ * CALIBRATION_BYTES of both buffers.  Returns the bandwidth in bytes per
+ * second.
+ */
+#define CALIBRATION_BYTES (32 << 20)
+
+static double estimate_runtime(struct test *list, ull mask, ulv *bufa,
+                             ulv *bufb, size_t count, size_t bufsize,
+                             ul loops) {
+    size_t n = count;
+    ull passes = 0, bytes = 0, region;
+    double t, rate;
+    int i, ntests = 0;
+
+    if (n > CALIBRATION_BYTES / 2 / sizeof(ul))
+        n = CALIBRATION_BYTES / 2 / sizeof(ul);
+    t = monotonic_time();
+    memtester_run_test(calibration_pass, bufa, bufb, n);
+    t = monotonic_time() - t;
+    rate = t > 0 ? 2.0 * 2 * n * sizeof(ul) / t : 0;
+
+    for (i = 0; list[i].name; i++) {
+        if (mask && !(mask & (1ULL << i)))
+            continue;
+        region = (list[i].flags & TEST_NEEDS_BUFB)
+                 ? (ull) count * 2 * sizeof(ul) : (ull) bufsize;
+        passes += list[i].writes + list[i].reads;
+        bytes += region * (list[i].writes + list[i].reads);
+        ntests++;
+    }
+    if (rate <= 0)
+        return 0;
+    printf("%d tests selected, %llu passes per word, about %.1fs per loop",
+           ntests, passes, bytes / rate);
+    if (loops > 1)
+        printf(" (%.0fs for %lu loops)", bytes / rate * loops, loops);
+    printf(" at %.2f GB/s\n", rate / 1e9);
+    return rate;
+}
+
 /* Global vars - so tests have access to this information */
 int use_phys = 0;
 int memtester_early_exit = 0;
@@ -103,7 +254,19 @@ off_t physaddrbase = 0;
 /* Function definitions */
 void usage(char *me) {
     fprintf(stderr, "\n"
-            "Usage: %s [-p physaddrbase [-d device]] <mem>[B|K|M|G] [loops]\n",
+            "Usage: %s [options] <mem>[B|K|M|G] [loops]\n"
+            "  -p physaddrbase  test physical memory starting at physaddrbase\n"
+            "  -d device        device to mmap with -p (default /dev/mem)\n"
+            "  -t threads       number of worker threads\n"
+            "  -s seed          seed for the random patterns\n"
+            "  -S               single buffer mode with self-verifying patterns\n"
+            "  -P               pipeline writes and verifies of the pattern tests\n"
+            "  -H               add a row hammer test at the end of every loop\n"
+            "  -b budget        run within a time budget, tests ordered by yield\n"
+            "  -F               re-test a small window around every failure\n"
+            "  -C               run every test to completion, rate-limit the reports\n"
+            "  -N               verify from DRAM, writing with streaming stores\n"
+            "  -R               visit the buffer in a random block order\n",
             me);
     exit(EXIT_FAIL_NONSTARTER);
 }
@@ -112,22 +275,45 @@ int memtester_main(int argc, char **argv) {
     ul loops, loop, i;
     size_t pagesize, wantraw, wantmb, wantbytes, wantbytes_orig, bufsize,
          halflen, count;
-    char *memsuffix, *addrsuffix, *loopsuffix;
+    char *memsuffix, *addrsuffix, *loopsuffix, *threadsuffix, *seedsuffix;
     ptrdiff_t pagesizemask;
     void volatile *buf, *aligned;
     ulv *bufa, *bufb;
     int do_mlock = 1, done_mem = 0;
-    int exit_code = 0;
+    int exit_code = 0, result, mirrored, deep;
     int memfd, opt, memshift;
     size_t maxbytes = -1; /* addressable memory, in bytes */
     size_t maxmb = (maxbytes >> 20) + 1; /* addressable memory, in MB */
     /* Device to mmap memory from with -p, default is normal core */
     char *device_name = "/dev/mem";
     struct stat statbuf;
+    memtester_buffer membuf;
+    double t_start, t_alloc, t_locked, t_ready;
     int device_specified = 0;
+    int single_buffer = 0;
+    struct test *test_list = tests;
     char *env_testmask = 0;
-    ul testmask = 0;
+    char *env_pipeline_lag = 0;
+    char *env_hammer = 0;
+    char *env_progress = 0;
+    char *env_stats = 0;
+    char *env_focus = 0;
+    char *env_evlog = 0;
+    char *env_rate = 0;
+    char *env_bypass = 0;
+    char *env_order = 0;
+    int bypass = 0;
+    ull bypassmask = 0;
+    ul evlog_records = EVLOG_RECORDS_DEFAULT;
+    ull region;
+    double t_test, rate;
+    int order[MAX_TESTS], norder, k, nrun = 0;
+    char *state_file = NULL, *budgetsuffix;
+    ull testmask = 0;
+    char *env_tests = 0;
+    ull seed = (ull) time(NULL) ^ ((ull) getpid() << 32);
 
+    t_start = monotonic_time();
     printf("memtester version " __version__ " (%d-bit)\n", UL_LEN);
     printf("Copyright (C) 2001-2012 Charles Cazabon.\n");
     printf("Licensed under the GNU General Public License version 2 (only).\n");
@@ -140,21 +326,48 @@ int memtester_main(int argc, char **argv) {
     if (getenv("MEMTESTER_EARLY_EXIT"))
         memtester_early_exit = 1;
 
+    if (env_progress = getenv("MEMTESTER_PROGRESS_INTERVAL")) {
+        errno = 0;
+        memtester_progress_interval = strtoul(env_progress, 0, 0);
+        if (errno) {
+            fprintf(stderr, "error parsing MEMTESTER_PROGRESS_INTERVAL %s\n",
+                    env_progress);
+            usage(argv[0]); /* doesn't return */
+        }
+    }
+
+    if (env_stats = getenv("MEMTESTER_SLOWDOWN_PERCENT")) {
+        errno = 0;
+        memtester_slowdown_percent = strtoul(env_stats, 0, 0);
+        if (errno || memtester_slowdown_percent > 100) {
+            fprintf(stderr, "error parsing MEMTESTER_SLOWDOWN_PERCENT %s\n",
+                    env_stats);
+            usage(argv[0]); /* doesn't return */
+        }
+    }
+
+    if ((env_stats = getenv("MEMTESTER_STATS_FILE")) &&
+        stats_open(env_stats) != 0) {
+        fprintf(stderr, "failed to open MEMTESTER_STATS_FILE %s: %s\n",
+                env_stats, strerror(errno));
+        exit(EXIT_FAIL_NONSTARTER);
+    }
+
     /* If MEMTESTER_TEST_MASK is set, we use its value as a mask of which
        tests we run.
      */
     if (env_testmask = getenv("MEMTESTER_TEST_MASK")) {
         errno = 0;
-        testmask = strtoul(env_testmask, 0, 0);
+        testmask = strtoull(env_testmask, 0, 0);
         if (errno) {
             fprintf(stderr, "error parsing MEMTESTER_TEST_MASK %s: %s\n", 
                     env_testmask, strerror(errno));
             usage(argv[0]); /* doesn't return */
         }
-        printf("using testmask 0x%lx\n", testmask);
+        printf("using testmask 0x%llx\n", testmask);
     }
 
-    while ((opt = getopt(argc, argv, "p:d:")) != -1) {
+    while ((opt = getopt(argc, argv, "p:d:t:s:b:SPHFCNR")) != -1) {
         switch (opt) {
             case 'p':
                 errno = 0;
@@ -197,6 +410,140 @@ int memtester_main(int argc, char **argv) {
                     }
                 }
                 break;              
+            case 't':
+                errno = 0;
+                memtester_threads = (int) strtoul(optarg, &threadsuffix, 0);
+                if (errno != 0 || *threadsuffix != '\0' ||
+                    memtester_threads < 1 ||
+                    memtester_threads > MEMTESTER_MAX_THREADS) {
+                    fprintf(stderr,
+                            "failed to parse threads arg; should be a number "
+                            "from 1 to %d\n", MEMTESTER_MAX_THREADS);
+                    usage(argv[0]); /* doesn't return */
+                }
+                break;
+            case 's':
+                errno = 0;
+                seed = strtoull(optarg, &seedsuffix, 0);
+                if (errno != 0 || *seedsuffix != '\0') {
+                    fprintf(stderr, "failed to parse seed arg\n");
+                    usage(argv[0]); /* doesn't return */
+                }
+                break;
+            case 'b':
+                errno = 0;
+                memtester_budget = strtod(optarg, &budgetsuffix);
+                if (errno != 0 || memtester_budget <= 0) {
+                    fprintf(stderr, "failed to parse time budget arg\n");
+                    usage(argv[0]); /* doesn't return */
+                }
+                switch (*budgetsuffix) {
+                    case 'h':
+                    case 'H':
+                        memtester_budget *= 60;
+                        /* fall through */
+                    case 'm':
+                    case 'M':
+                        memtester_budget *= 60;
+                        budgetsuffix++;
+                        break;
+                    case 's':
+                    case 'S':
+                        budgetsuffix++;
+                        break;
+                }
+                if (*budgetsuffix != '\0') {
+                    fprintf(stderr, "time budget suffix %c\n", *budgetsuffix);
+                    usage(argv[0]); /* doesn't return */
+                }
+                break;
+            case 'F':
+                memtester_focus = 1;
+                if (env_focus = getenv("MEMTESTER_FOCUS_WINDOW")) {
+                    errno = 0;
+                    memtester_focus_window = strtoul(env_focus, 0, 0);
+                    if (errno || memtester_focus_window < 4096) {
+                        fprintf(stderr, "error parsing MEMTESTER_FOCUS_WINDOW "
+                                "%s\n", env_focus);
+                        usage(argv[0]); /* doesn't return */
+                    }
+                }
+                if (env_focus = getenv("MEMTESTER_FOCUS_SECONDS")) {
+                    errno = 0;
+                    memtester_focus_seconds = strtod(env_focus, 0);
+                    if (errno || memtester_focus_seconds <= 0) {
+                        fprintf(stderr, "error parsing MEMTESTER_FOCUS_SECONDS "
+                                "%s\n", env_focus);
+                        usage(argv[0]); /* doesn't return */
+                    }
+                }
+                break;
+            case 'C':
+                memtester_continue = 1;
+                if (env_rate = getenv("MEMTESTER_REPORT_RATE")) {
+                    errno = 0;
+                    memtester_report_rate = strtoul(env_rate, 0, 0);
+                    if (errno) {
+                        fprintf(stderr, "error parsing MEMTESTER_REPORT_RATE "
+                                "%s\n", env_rate);
+                        usage(argv[0]); /* doesn't return */
+                    }
+                }
+                break;
+            case 'N':
+                bypass = 1;
+                break;
+            case 'R':
+                memtester_random_order = 1;
+                if (env_order = getenv("MEMTESTER_ORDER_BLOCK")) {
+                    errno = 0;
+                    memtester_order_block = strtoul(env_order, 0, 0);
+                    if (errno || memtester_order_block < 16 * sizeof(ul) ||
+                        (memtester_order_block &
+                         (memtester_order_block - 1))) {
+                        fprintf(stderr, "error parsing MEMTESTER_ORDER_BLOCK "
+                                "%s\n", env_order);
+                        usage(argv[0]); /* doesn't return */
+                    }
+                }
+                break;
+            case 'S':
+                single_buffer = 1;
+                test_list = tests_single;
+                break;
+            case 'P':
+                memtester_pipeline_lag = PIPELINE_LAG_DEFAULT;
+                if (env_pipeline_lag = getenv("MEMTESTER_PIPELINE_LAG")) {
+                    errno = 0;
+                    memtester_pipeline_lag = strtoul(env_pipeline_lag, 0, 0);
+                    if (errno || !memtester_pipeline_lag) {
+                        fprintf(stderr, "error parsing MEMTESTER_PIPELINE_LAG "
+                                "%s\n", env_pipeline_lag);
+                        usage(argv[0]); /* doesn't return */
+                    }
+                }
+                break;
+            case 'H':
+                memtester_hammer = 1;
+                if (env_hammer = getenv("MEMTESTER_HAMMER_PAIRS")) {
+                    errno = 0;
+                    memtester_hammer_pairs = strtoul(env_hammer, 0, 0);
+                    if (errno || !memtester_hammer_pairs) {
+                        fprintf(stderr, "error parsing MEMTESTER_HAMMER_PAIRS "
+                                "%s\n", env_hammer);
+                        usage(argv[0]); /* doesn't return */
+                    }
+                }
+                if (env_hammer = getenv("MEMTESTER_HAMMER_ROUNDS")) {
+                    errno = 0;
+                    memtester_hammer_rounds = strtoul(env_hammer, 0, 0);
+                    if (errno || !memtester_hammer_rounds) {
+                        fprintf(stderr, "error parsing "
+                                "MEMTESTER_HAMMER_ROUNDS %s\n", env_hammer);
+                        usage(argv[0]); /* doesn't return */
+                    }
+                }
+                break;
             default: /* '?' */
                 usage(argv[0]); /* doesn't return */
         }
@@ -208,6 +555,25 @@ int memtester_main(int argc, char **argv) {
         usage(argv[0]); /* doesn't return */
     }
     
+    /* MEMTESTER_TESTS selects by name, it needs the list picked by -S. */
+    if (env_tests = getenv("MEMTESTER_TESTS")) {
+        testmask = select_tests(test_list, env_tests);
+        if (!testmask)
+            usage(argv[0]); /* doesn't return */
+        printf("using testmask 0x%llx\n", testmask);
+    }
+
+    /* -N applies to all the tests, or those named by MEMTESTER_BYPASS_TESTS. */
+    if (bypass) {
+        bypassmask = ~0ULL;
+        if (env_bypass = getenv("MEMTESTER_BYPASS_TESTS")) {
+            bypassmask = select_tests(test_list, env_bypass);
+            if (!bypassmask)
+                usage(argv[0]); /* doesn't return */
+            printf("bypassing the caches for mask 0x%llx\n", bypassmask);
+        }
+    }
+
     if (optind >= argc) {
         fprintf(stderr, "need memory argument, in MB\n");
         usage(argv[0]); /* doesn't return */
@@ -272,6 +638,7 @@ int memtester_main(int argc, char **argv) {
     }
 
     printf("want %lluMB (%llu bytes)\n", (ull) wantmb, (ull) wantbytes);
+    t_alloc = monotonic_time();
     buf = NULL;
 
     if (use_phys) {
@@ -300,63 +667,42 @@ int memtester_main(int argc, char **argv) {
         done_mem = 1;
     }
 
-    while (!done_mem) {
-        while (!buf && wantbytes) {
-            buf = (void volatile *) malloc(wantbytes);
-            if (!buf) wantbytes -= pagesize;
+    if (!done_mem) {
+        /* Fault the buffer in from all the cores, or as many as -t asks. */
+        memtester_prefault_threads = memtester_threads;
+        if (memtester_prefault_threads <= 1) {
+            memtester_prefault_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
         }
-        bufsize = wantbytes;
-        printf("got  %lluMB (%llu bytes)", (ull) wantbytes >> 20,
-            (ull) wantbytes);
-        fflush(stdout);
-        if (do_mlock) {
-            printf(", trying mlock ...");
-            fflush(stdout);
-            if ((size_t) buf % pagesize) {
-                /* printf("aligning to page -- was 0x%tx\n", buf); */
-                aligned = (void volatile *) ((size_t) buf & pagesizemask) + pagesize;
-                /* printf("  now 0x%tx -- lost %d bytes\n", aligned,
-                 *      (size_t) aligned - (size_t) buf);
-                 */
-                bufsize -= ((size_t) aligned - (size_t) buf);
-            } else {
-                aligned = buf;
-            }
-            /* Try mlock */
-            if (mlock((void *) aligned, bufsize) < 0) {
-                switch(errno) {
-                    case EAGAIN: /* BSDs */
-                        printf("over system/pre-process limit, reducing...\n");
-                        free((void *) buf);
-                        buf = NULL;
-                        wantbytes -= pagesize;
-                        break;
-                    case ENOMEM:
-                        printf("too many pages, reducing...\n");
-                        free((void *) buf);
-                        buf = NULL;
-                        wantbytes -= pagesize;
-                        break;
-                    case EPERM:
-                        printf("insufficient permission.\n");
-                        printf("Trying again, unlocked:\n");
-                        do_mlock = 0;
-                        free((void *) buf);
-                        buf = NULL;
-                        wantbytes = wantbytes_orig;
-                        break;
-                    default:
-                        printf("failed for unknown reason.\n");
-                        do_mlock = 0;
-                        done_mem = 1;
-                }
-            } else {
-                printf("locked.\n");
-                done_mem = 1;
-            }
+        if (memtester_prefault_threads > MEMTESTER_MAX_THREADS) {
+            memtester_prefault_threads = MEMTESTER_MAX_THREADS;
+        }
+        if (memtester_alloc(&membuf, wantbytes, pagesize, do_mlock) != 0) {
+            fprintf(stderr, "failed to allocate memory for testing: %s\n",
+                    strerror(errno));
+            exit(EXIT_FAIL_NONSTARTER);
+        }
+        buf = aligned = membuf.base;
+        bufsize = membuf.size;
+        do_mlock = membuf.locked;
+        done_mem = 1;
+    }
+
+    t_locked = monotonic_time();
+
+    if (use_phys) {
+        dram_init();
+    }
+
+    /* The pages only stay at the same physical address while locked. */
+    if (!use_phys && do_mlock) {
+        size_t nruns = pagemap_init(aligned, bufsize, pagesize);
+        if (nruns) {
+            printf("buffer is in %llu physically contiguous runs, failures "
+                   "are reported with physical addresses\n", (ull) nruns);
+            dram_init();
         } else {
-            done_mem = 1;
-            printf("\n");
+            printf("physical addresses not available from "
+                   "/proc/self/pagemap\n");
         }
     }
 
@@ -367,6 +713,71 @@ int memtester_main(int argc, char **argv) {
     count = halflen / sizeof(ul);
     bufa = (ulv *) aligned;
     bufb = (ulv *) ((size_t) aligned + halflen);
+    kernels_init(1);
+    prng_init(seed);
+    if (errmap_init(bufsize, pagesize) != 0) {
+        fprintf(stderr, "failed to allocate the error map, "
+                "bad pages will not be tracked\n");
+    }
+    printf("using random seed 0x%016llx (reproduce with -s)\n", seed);
+    if (memtester_pipeline_lag) {
+        printf("pipelined pattern tests, verify lag %lluKB\n",
+               (ull) memtester_pipeline_lag >> 10);
+    }
+    if (single_buffer) {
+        printf("single buffer mode, testing all %lluMB in one pass\n",
+               (ull) bufsize >> 20);
+    }
+    if (memtester_threads > 1) {
+        printf("using %d worker threads\n", memtester_threads);
+    }
+
+    rate = estimate_runtime(test_list, testmask, bufa, bufb, count, bufsize,
+                            loops);
+    if (memtester_budget || getenv("MEMTESTER_STATE_FILE")) {
+        state_file = getenv("MEMTESTER_STATE_FILE");
+        if (!state_file)
+            state_file = SCHED_STATE_FILE_DEFAULT;
+    }
+    sched_init(test_list, single_buffer, state_file, rate);
+    if (memtester_budget) {
+        printf("time budget %.0fs, tests ordered by the history in %s\n",
+               memtester_budget, state_file);
+    }
+
+    if (env_evlog = getenv("MEMTESTER_EVENT_LOG_RECORDS")) {
+        errno = 0;
+        evlog_records = strtoul(env_evlog, 0, 0);
+        if (errno || !evlog_records) {
+            fprintf(stderr, "error parsing MEMTESTER_EVENT_LOG_RECORDS %s\n",
+                    env_evlog);
+            usage(argv[0]); /* doesn't return */
+        }
+    }
+    if (env_evlog = getenv("MEMTESTER_EVENT_LOG_INTERVAL")) {
+        errno = 0;
+        evlog_interval = strtoul(env_evlog, 0, 0);
+        if (errno) {
+            fprintf(stderr, "error parsing MEMTESTER_EVENT_LOG_INTERVAL %s\n",
+                    env_evlog);
+            usage(argv[0]); /* doesn't return */
+        }
+    }
+    if (env_evlog = getenv("MEMTESTER_EVENT_LOG")) {
+        if (evlog_open(env_evlog, evlog_records, test_list) != 0) {
+            fprintf(stderr, "failed to create the event log %s: %s\n",
+                    env_evlog, strerror(errno));
+            exit(EXIT_FAIL_NONSTARTER);
+        }
+        printf("logging events to %s (%lu records)\n", env_evlog,
+               evlog_records);
+        evlog_event(EVLOG_START, 0, bufsize, seed);
+    }
+
+    progress_init();
+    t_ready = monotonic_time();
+    printf("time to first test %.2fs (allocation and locking %.2fs)\n",
+           t_ready - t_start, t_locked - t_alloc);
 
     for(loop=1; ((!loops) || loop <= loops); loop++) {
         printf("Loop %lu", loop);
@@ -375,35 +786,138 @@ int memtester_main(int argc, char **argv) {
         }
         printf(":\n");
         fflush(stdout);
+        evlog_loop(loop);
         if (!getenv("MEMTESTER_SKIP_STUCK_ADDRESS")) {
+            /* A single walk over the whole region, no worker stripes. */
+            printf("  %-20s: ", "Address Lines");
+            fflush(stdout);
+            result = test_address_lines(aligned, bufsize / sizeof(ul));
+            report_flush();
+            if (!result) {
+                printf("ok\n");
+            } else {
+                exit_code |= EXIT_FAIL_ADDRESSLINES;
+            }
+        }
+        /* The 16-pass sweep is opt-in, and must fit in the -b budget. */
+        deep = getenv("MEMTESTER_DEEP_STUCK_ADDRESS") &&
+               !getenv("MEMTESTER_SKIP_STUCK_ADDRESS");
+        if (deep && memtester_budget && (rate <= 0 ||
+                monotonic_time() - t_ready + STUCK_ADDRESS_PASSES *
+                (double) bufsize / rate > memtester_budget)) {
+            deep = 0;
+        }
+        if (deep) {
             printf("  %-20s: ", "Stuck Address");
             fflush(stdout);
-            if (!test_stuck_address(aligned, bufsize / sizeof(ul))) {
+            progress_begin(-1);
+            result = memtester_run_test(test_stuck_address, aligned, NULL,
+                                        bufsize / sizeof(ul));
+            progress_end();
+            report_flush();
+            if (!result) {
                 printf("ok\n");
             } else {
                 exit_code |= EXIT_FAIL_ADDRESSLINES;
             }
         }
-        for (i=0;;i++) {
-            if (!tests[i].name) break;
-            /* If using a custom testmask, only run this test if the
-               bit corresponding to this test was set by the user.
-             */
-            if (testmask && (!((1 << i) & testmask))) {
+        mirrored = 0;
+        /* The tests selected by the testmask, reordered with -b. */
+        norder = sched_order(order, testmask, loop == 1);
+        for (k = 0, nrun = 0; k < norder; k++) {
+            i = order[k];
+            region = (test_list[i].flags & TEST_NEEDS_BUFB)
+                     ? (ull) count * 2 * sizeof(ul) : (ull) bufsize;
+            if (memtester_budget && monotonic_time() - t_ready +
+                    sched_estimate((int) i, region) > memtester_budget) {
                 continue;
             }
-            printf("  %-20s: ", tests[i].name);
-            if (!tests[i].fp(bufa, bufb, count)) {
+            printf("  %-20s: ", test_list[i].name);
+            fflush(stdout);
+            /* The address line tests, Modulo 20 and failed tests leave bufa
+               and bufb different, which used to fail XOR etc. if Random
+               Value was not selected. */
+            if ((test_list[i].flags & TEST_NEEDS_MIRROR) && !mirrored)
+                copy_region(bufb, bufa, count);
+            memtester_bypass = (int) ((bypassmask >> i) & 1);
+            kernels_set_streaming(memtester_bypass);
+            evlog_test((int) i);
+            progress_begin((int) i);
+            t_test = monotonic_time();
+            result = (test_list[i].flags & TEST_NEEDS_BUFB)
+                     ? memtester_run_test(test_list[i].fp, bufa, bufb, count)
+                     : memtester_run_test(test_list[i].fp, aligned, NULL,
+                                          bufsize / sizeof(ul));
+            t_test = monotonic_time() - t_test;
+            progress_end();
+            /* The -C summary belongs to this test, not the next one. */
+            report_flush();
+            nrun++;
+            mirrored = !result && (test_list[i].flags & TEST_MIRRORS);
+            /* A failing test bails out early, its bandwidth is not
+               representative. */
+            if (!result) {
+                stats_record((int) i, test_list[i].name, t_test,
+                             region * test_list[i].writes,
+                             region * test_list[i].reads);
+            }
+            sched_record((int) i, region, t_test, result);
+            if (!result) {
                 printf("ok\n");
             } else {
                 exit_code |= EXIT_FAIL_OTHERTEST;
+                sched_save();
+                if (memtester_focus)
+                    focus_run(test_list, (int) i, bufa, bufb, count, bufsize);
+            }
+            fflush(stdout);
+        }
+        memtester_bypass = 0;
+        kernels_set_streaming(0);
+        if (memtester_hammer) {
+            /* The whole region at once, the pairs span the stripes. */
+            printf("  %-20s: ", "Row Hammer");
+            fflush(stdout);
+            if (!hammer_supported()) {
+                printf("skipped, the reads would not leave the cache "
+                       "without -p\n");
+            } else {
+                result = test_row_hammer(aligned, bufsize / sizeof(ul));
+                report_flush();
+                if (!result) {
+                    printf("ok\n");
+                } else {
+                    exit_code |= EXIT_FAIL_OTHERTEST;
+                }
             }
             fflush(stdout);
         }
+        stats_loop_end(loop);
+        if (sched_save() != 0) {
+            fprintf(stderr, "failed to save the test history to %s\n",
+                    state_file);
+        }
+        if (memtester_errors.nerrors) {
+            errmap_print(stdout);
+            dram_print(stdout);
+        }
         printf("\n");
         fflush(stdout);
+        if (memtester_budget && (!nrun ||
+                monotonic_time() - t_ready >= memtester_budget)) {
+            printf("time budget of %.0fs used up after %lu loops\n",
+                   memtester_budget, nrun ? loop : loop - 1);
+            break;
+        }
+    }
+    if (use_phys) {
+        if (do_mlock) munlock((void *) aligned, bufsize);
+    } else {
+        pagemap_free();
+        memtester_free(&membuf);
     }
-    if (do_mlock) munlock((void *) aligned, bufsize);
+    progress_shutdown();
+    evlog_close();
     printf("Done.\n");
     fflush(stdout);
     exit(exit_code);
@@ -20,4 +20,8 @@
 extern int use_phys;
 extern off_t physaddrbase;
 extern int memtester_early_exit;
+extern size_t memtester_pipeline_lag;
+extern int memtester_continue;
+extern unsigned int memtester_report_rate;
+extern int memtester_bypass;
 
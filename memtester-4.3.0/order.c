@@ -0,0 +1,69 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the randomized traversal order (-R).  Walking memory
+ * linearly lets the prefetchers hide the latency and keeps DRAM in page
+ * hits.  Visiting the blocks of the buffer in a random order makes nearly
+ * every block open another row, and often switch banks, while each block
+ * is still written and read linearly by the SIMD kernels.
+ *
+ */
+
+#include "types.h"
+#include "order.h"
+
+int memtester_random_order = 0;
+size_t memtester_order_block = ORDER_BLOCK_DEFAULT;
+
+void order_init(memtester_order_t *o, size_t count, ul seed) {
+    unsigned int bits = 0, r;
+    ull z = seed;
+
+    o->block = memtester_order_block / sizeof(ul);
+    o->nblocks = (count + o->block - 1) / o->block;
+    while (bits < 62 && ((ull) 1 << bits) < o->nblocks)
+        bits++;
+    /* An even number of bits, so that both halves are the same size. */
+    o->half = (bits + 1) / 2;
+    if (!o->half)
+        o->half = 1;
+    for (r = 0; r < ORDER_ROUNDS; r++) {
+        z += 0x9e3779b97f4a7c15ULL;
+        o->keys[r] = (ul) ((z ^ (z >> 31)) * 0xbf58476d1ce4e5b9ULL >> 32);
+    }
+}
+
+static inline ull round_function(ull x, ul key) {
+    x = (x ^ key) * 0x9e3779b97f4a7c15ULL;
+    return x ^ (x >> 29);
+}
+
+/*
+ * A Feistel network is a permutation of [0, 4^half) whatever the round
+ * function.  Values at or above nblocks are mapped again ("cycle walking"),
+ * which keeps it a permutation of [0, nblocks); as 4^half < 4 * nblocks
+ * this takes less than four steps on average.
+ */
+size_t order_block(const memtester_order_t *o, size_t i) {
+    ull mask = ((ull) 1 << o->half) - 1, x = i, left, right, t;
+    unsigned int r;
+
+    do {
+        left = x >> o->half;
+        right = x & mask;
+        for (r = 0; r < ORDER_ROUNDS; r++) {
+            t = right;
+            right = (left ^ round_function(right, o->keys[r])) & mask;
+            left = t;
+        }
+        x = (left << o->half) | right;
+    } while (x >= o->nblocks);
+    return (size_t) x * o->block;
+}
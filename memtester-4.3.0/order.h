@@ -0,0 +1,52 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the randomized traversal order.
+ *
+ */
+
+#ifndef MEMTESTER_ORDER_H
+#define MEMTESTER_ORDER_H
+
+#include <stddef.h>
+
+#define ORDER_BLOCK_DEFAULT 2048    /* bytes */
+#define ORDER_ROUNDS        4
+
+/* Set by -R. */
+extern int memtester_random_order;
+
+/*
+ * Bytes visited in a row, a power of two of at least 16 words.  Each block
+ * costs a row activation and a miss the prefetchers cannot hide: blocks of
+ * a cache line stress DRAM the most, but are several times slower than the
+ * linear order, 2kB blocks cost about 10% of the bandwidth.
+ */
+extern size_t memtester_order_block;
+
+/*
+ * A pseudo-random permutation of the blocks of a region, computed on the
+ * fly by a Feistel network over the block index, so that no index table
+ * is stored.
+ */
+typedef struct memtester_order_t {
+    size_t block;       /* words */
+    size_t nblocks;
+    unsigned int half;  /* bits in each half of the Feistel network */
+    unsigned long keys[ORDER_ROUNDS];
+} memtester_order_t;
+
+/* Set up a permutation of the blocks of 'count' words, keyed by 'seed'. */
+void order_init(memtester_order_t *o, size_t count, unsigned long seed);
+
+/* Index of the first word of the i-th block visited, for i < nblocks. */
+size_t order_block(const memtester_order_t *o, size_t i);
+
+#endif
@@ -0,0 +1,126 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the virtual to physical address translation of the
+ * test buffer, so that failures can be reported by physical address
+ * without -p.  /proc/self/pagemap is read once, after the buffer has been
+ * locked, into a sorted table of physically contiguous runs.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "pagemap.h"
+
+#define PAGEMAP_PRESENT (1ULL << 63)
+#define PAGEMAP_PFN_MASK ((1ULL << 55) - 1)
+#define PAGEMAP_BATCH 4096 /* entries read at once */
+
+static pagemap_run *runs;
+static size_t nruns;
+
+/* Append a page to the table, extending the last run if it is contiguous. */
+static int add_page(size_t *alloc, size_t offset, unsigned long long phys,
+                    size_t pagesize) {
+    pagemap_run *r = nruns ? &runs[nruns - 1] : NULL;
+    pagemap_run *grown;
+
+    if (r && r->offset + r->len == offset && r->phys + r->len == phys) {
+        r->len += pagesize;
+        return 0;
+    }
+    if (nruns == *alloc) {
+        *alloc = *alloc ? *alloc * 2 : 64;
+        grown = realloc(runs, *alloc * sizeof(*runs));
+        if (!grown)
+            return -1;
+        runs = grown;
+    }
+    r = &runs[nruns++];
+    r->offset = offset;
+    r->len = pagesize;
+    r->phys = phys;
+    return 0;
+}
+
+size_t pagemap_init(void volatile *base, size_t size, size_t pagesize) {
+    uint64_t entries[PAGEMAP_BATCH];
+    size_t alloc = 0, npages = size / pagesize, page = 0, n, i;
+    off_t pos = (off_t) ((size_t) base / pagesize) * sizeof(uint64_t);
+    ssize_t got;
+    int fd;
+
+    pagemap_free();
+    fd = open("/proc/self/pagemap", O_RDONLY);
+    if (fd < 0)
+        return 0;
+    while (page < npages) {
+        n = npages - page < PAGEMAP_BATCH ? npages - page : PAGEMAP_BATCH;
+        got = pread(fd, entries, n * sizeof(uint64_t),
+                    pos + (off_t) (page * sizeof(uint64_t)));
+        if (got <= 0)
+            break;
+        n = (size_t) got / sizeof(uint64_t);
+        for (i = 0; i < n; i++, page++) {
+            /* Without CAP_SYS_ADMIN the frame numbers read as zero. */
+            if (!(entries[i] & PAGEMAP_PRESENT) ||
+                !(entries[i] & PAGEMAP_PFN_MASK))
+                continue;
+            if (add_page(&alloc, page * pagesize,
+                         (entries[i] & PAGEMAP_PFN_MASK) *
+                         (unsigned long long) pagesize, pagesize) != 0) {
+                close(fd);
+                pagemap_free();
+                return 0;
+            }
+        }
+    }
+    close(fd);
+    return nruns;
+}
+
+int pagemap_lookup(size_t offset, unsigned long long *phys) {
+    size_t lo = 0, hi = nruns, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (offset < runs[mid].offset) {
+            hi = mid;
+        } else if (offset - runs[mid].offset >= runs[mid].len) {
+            lo = mid + 1;
+        } else {
+            *phys = runs[mid].phys + (offset - runs[mid].offset);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int pagemap_offset(unsigned long long phys, size_t *offset) {
+    size_t i;
+
+    for (i = 0; i < nruns; i++) {
+        if (phys >= runs[i].phys && phys - runs[i].phys < runs[i].len) {
+            *offset = runs[i].offset + (size_t) (phys - runs[i].phys);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void pagemap_free(void) {
+    free(runs);
+    runs = NULL;
+    nruns = 0;
+}
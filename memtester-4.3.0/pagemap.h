@@ -0,0 +1,52 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the virtual to physical address
+ * translation.
+ *
+ */
+
+#ifndef MEMTESTER_PAGEMAP_H
+#define MEMTESTER_PAGEMAP_H
+
+#include <stddef.h>
+
+/* Physically contiguous part of the test buffer. */
+typedef struct pagemap_run {
+    size_t offset;              /* bytes from the start of the buffer */
+    size_t len;                 /* bytes */
+    unsigned long long phys;    /* physical address of the first byte */
+} pagemap_run;
+
+/*
+ * Read /proc/self/pagemap for the 'size' bytes at 'base' and build the
+ * table of physical runs.  The buffer must be locked, so that the pages
+ * stay where they are.  Returns the number of runs, or 0 if the physical
+ * addresses are not available (the kernel hides them from non-root users).
+ */
+size_t pagemap_init(void volatile *base, size_t size, size_t pagesize);
+
+/*
+ * Translate an offset into the buffer to a physical address, by a binary
+ * search of the table.  No system call is made, so this can be used for
+ * every failure.  Returns 0 on success, -1 if the offset is not mapped.
+ */
+int pagemap_lookup(size_t offset, unsigned long long *phys);
+
+/*
+ * The reverse translation, from a physical address to an offset into the
+ * buffer.  This one walks the table.  Returns 0 on success, -1 if the
+ * address is not in the buffer.
+ */
+int pagemap_offset(unsigned long long phys, size_t *offset);
+
+void pagemap_free(void);
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the pseudo-random number generator.  It replaces libc
+ * rand(), which takes a lock on every call and needs several calls per word.
+ * The generator is xoshiro256** by David Blackman and Sebastiano Vigna.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "prng.h"
+#include "threads.h"
+
+uint64_t memtester_seed;
+
+static prng_state streams[MEMTESTER_MAX_THREADS];
+
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+void prng_seed(prng_state *st, uint64_t seed) {
+    int i;
+
+    for (i = 0; i < 4; i++)
+        st->s[i] = splitmix64(&seed);
+}
+
+void prng_jump(prng_state *st) {
+    static const uint64_t jump[] = {
+        0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+        0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+    };
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    int i, b;
+
+    for (i = 0; i < 4; i++) {
+        for (b = 0; b < 64; b++) {
+            if (jump[i] & ((uint64_t) 1 << b)) {
+                s0 ^= st->s[0];
+                s1 ^= st->s[1];
+                s2 ^= st->s[2];
+                s3 ^= st->s[3];
+            }
+            prng_next(st);
+        }
+    }
+    st->s[0] = s0;
+    st->s[1] = s1;
+    st->s[2] = s2;
+    st->s[3] = s3;
+}
+
+void prng_init(uint64_t seed) {
+    int i;
+
+    memtester_seed = seed;
+    prng_seed(&streams[0], seed);
+    for (i = 1; i < MEMTESTER_MAX_THREADS; i++) {
+        streams[i] = streams[i - 1];
+        prng_jump(&streams[i]);
+    }
+}
+
+prng_state *prng_stream(void) {
+    return &streams[memtester_thread_id];
+}
+
+void prng_fill(unsigned long *buf, size_t count) {
+    uint64_t s0[PRNG_LANES], s1[PRNG_LANES], s2[PRNG_LANES], s3[PRNG_LANES];
+    uint64_t seed;
+    prng_state *st = prng_stream();
+    size_t i;
+    int l;
+
+    for (l = 0; l < PRNG_LANES; l++) {
+        seed = prng_next(st);
+        s0[l] = splitmix64(&seed);
+        s1[l] = splitmix64(&seed);
+        s2[l] = splitmix64(&seed);
+        s3[l] = splitmix64(&seed);
+    }
+    for (i = 0; i + PRNG_LANES <= count; i += PRNG_LANES) {
+        for (l = 0; l < PRNG_LANES; l++) {
+            uint64_t t = s1[l] << 17;
+
+            buf[i + l] = (unsigned long) (prng_rotl(s1[l] * 5, 7) * 9);
+            s2[l] ^= s0[l];
+            s3[l] ^= s1[l];
+            s1[l] ^= s2[l];
+            s0[l] ^= s3[l];
+            s2[l] ^= t;
+            s3[l] = prng_rotl(s3[l], 45);
+        }
+    }
+    for (; i < count; i++)
+        buf[i] = (unsigned long) prng_next(st);
+}
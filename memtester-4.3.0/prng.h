@@ -0,0 +1,73 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the pseudo-random number
+ * generator used by the tests (xoshiro256**).
+ *
+ */
+
+#ifndef MEMTESTER_PRNG_H
+#define MEMTESTER_PRNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct prng_state {
+    uint64_t s[4];
+} prng_state;
+
+/* Number of interleaved generators used by prng_fill(). */
+#define PRNG_LANES 4
+
+/* Seed of the current run, printed so that a run can be reproduced. */
+extern uint64_t memtester_seed;
+
+/* Seed one generator from a 64-bit value. */
+void prng_seed(prng_state *st, uint64_t seed);
+
+/* Advance a generator by 2^128 steps, giving a non-overlapping stream. */
+void prng_jump(prng_state *st);
+
+static inline uint64_t prng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t prng_next(prng_state *st) {
+    uint64_t *s = st->s;
+    uint64_t result = prng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = prng_rotl(s[3], 45);
+    return result;
+}
+
+/*
+ * Set up one stream per worker thread from 'seed'.  Stream N is the seeded
+ * generator jumped N times, so a run with the same seed and the same
+ * number of threads produces the same data.
+ */
+void prng_init(uint64_t seed);
+
+/* The stream of the calling worker thread. */
+prng_state *prng_stream(void);
+
+/*
+ * Fill 'count' words with random data from the calling worker's stream.
+ * The data comes from PRNG_LANES interleaved generators kept in a
+ * structure-of-arrays layout so that the compiler can vectorize them.
+ */
+void prng_fill(unsigned long *buf, size_t count);
+
+#endif
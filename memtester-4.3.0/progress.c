@@ -0,0 +1,149 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the progress reporter.  A thread samples the counters
+ * updated by the tests and redraws the status after the test name, so a
+ * slow console never stalls the tests.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "progress.h"
+
+#define PROGRESS_STATUS_MAX 40
+
+memtester_progress_t memtester_progress = { -1, NULL, 0, 0, 0 };
+unsigned int memtester_progress_interval = PROGRESS_INTERVAL_DEFAULT;
+
+static const char spinner[] = "-\\|/";
+
+static pthread_mutex_t progress_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t progress_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t reporter;
+static int reporter_running;
+static int reporter_quit;
+static int active;
+static size_t shown;                        /* characters on screen */
+static char last[PROGRESS_STATUS_MAX];
+
+/* Remove the status from the screen.  Called with the mutex held. */
+static void erase(void) {
+    size_t i;
+
+    if (!shown)
+        return;
+    for (i = 0; i < shown; i++)
+        putchar('\b');
+    for (i = 0; i < shown; i++)
+        putchar(' ');
+    for (i = 0; i < shown; i++)
+        putchar('\b');
+    shown = 0;
+    last[0] = '\0';
+}
+
+/* Redraw the status if it changed.  Called with the mutex held. */
+static void redraw(void) {
+    char status[PROGRESS_STATUS_MAX];
+    const char *phase;
+    unsigned long long mb;
+    size_t i, len;
+
+    phase = __atomic_load_n(&memtester_progress.phase, __ATOMIC_RELAXED);
+    mb = __atomic_load_n(&memtester_progress.bytes, __ATOMIC_RELAXED) >> 20;
+    if (phase) {
+        len = snprintf(status, sizeof(status), "%s %3u", phase,
+                       __atomic_load_n(&memtester_progress.iteration,
+                                       __ATOMIC_RELAXED));
+    } else {
+        len = snprintf(status, sizeof(status), "%c",
+                       spinner[__atomic_load_n(&memtester_progress.spin,
+                                               __ATOMIC_RELAXED) % 4]);
+    }
+    if (mb && len < sizeof(status))
+        len += snprintf(status + len, sizeof(status) - len, " %lluMB", mb);
+    if (len >= sizeof(status))
+        len = sizeof(status) - 1;
+    if (strcmp(status, last) == 0)
+        return;
+    for (i = 0; i < shown; i++)
+        putchar('\b');
+    fputs(status, stdout);
+    /* Blank the tail of a longer previous status. */
+    for (i = len; i < shown; i++)
+        putchar(' ');
+    for (i = len; i < shown; i++)
+        putchar('\b');
+    shown = len;
+    memcpy(last, status, len + 1);
+    fflush(stdout);
+}
+
+static void *reporter_main(void *arg) {
+    struct timespec ts;
+
+    (void) arg;
+    pthread_mutex_lock(&progress_mutex);
+    while (!reporter_quit) {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += (long) (memtester_progress_interval % 1000) * 1000000;
+        ts.tv_sec += memtester_progress_interval / 1000 +
+                     ts.tv_nsec / 1000000000;
+        ts.tv_nsec %= 1000000000;
+        pthread_cond_timedwait(&progress_cond, &progress_mutex, &ts);
+        if (active && !reporter_quit)
+            redraw();
+    }
+    pthread_mutex_unlock(&progress_mutex);
+    return NULL;
+}
+
+void progress_init(void) {
+    if (!memtester_progress_interval || reporter_running)
+        return;
+    reporter_quit = 0;
+    if (pthread_create(&reporter, NULL, reporter_main, NULL) == 0)
+        reporter_running = 1;
+}
+
+void progress_shutdown(void) {
+    if (!reporter_running)
+        return;
+    pthread_mutex_lock(&progress_mutex);
+    reporter_quit = 1;
+    pthread_cond_signal(&progress_cond);
+    pthread_mutex_unlock(&progress_mutex);
+    pthread_join(reporter, NULL);
+    reporter_running = 0;
+}
+
+void progress_begin(int test) {
+    pthread_mutex_lock(&progress_mutex);
+    progress_store(test, test);
+    progress_store(phase, NULL);
+    progress_store(iteration, 0);
+    progress_store(spin, 0);
+    progress_store(bytes, 0);
+    active = 1;
+    pthread_mutex_unlock(&progress_mutex);
+}
+
+void progress_end(void) {
+    pthread_mutex_lock(&progress_mutex);
+    active = 0;
+    erase();
+    fflush(stdout);
+    progress_store(test, -1);
+    pthread_mutex_unlock(&progress_mutex);
+}
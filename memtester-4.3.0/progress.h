@@ -0,0 +1,74 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the progress reporter.
+ *
+ */
+
+#ifndef MEMTESTER_PROGRESS_H
+#define MEMTESTER_PROGRESS_H
+
+#include <stddef.h>
+
+#include "threads.h"
+
+#define PROGRESS_INTERVAL_DEFAULT 250 /* ms */
+
+/*
+ * Written by the tests with relaxed atomic stores, read by the reporter
+ * thread at a fixed rate.  The tests never do any I/O for the progress.
+ */
+typedef struct memtester_progress_t {
+    int test;                   /* index in the test list, -1 if none */
+    const char *phase;          /* "setting", "testing" or NULL */
+    unsigned int iteration;
+    unsigned int spin;          /* bumped by the tests without phases */
+    unsigned long long bytes;   /* bytes verified in the current test */
+} memtester_progress_t;
+
+extern memtester_progress_t memtester_progress;
+
+/* Interval between two updates of the progress display, 0 to disable. */
+extern unsigned int memtester_progress_interval;
+
+#define progress_store(field, v) \
+    __atomic_store_n(&memtester_progress.field, (v), __ATOMIC_RELAXED)
+
+/* Only the first worker reports phases, they run in lock-step anyway. */
+#define progress_phase(ph, j) \
+    do { \
+        if (memtester_is_main_thread()) { \
+            progress_store(phase, (ph)); \
+            progress_store(iteration, (j)); \
+        } \
+    } while (0)
+
+#define progress_spin(j) \
+    do { \
+        if (memtester_is_main_thread()) \
+            progress_store(spin, (j)); \
+    } while (0)
+
+#define progress_bytes(n) \
+    __atomic_fetch_add(&memtester_progress.bytes, (unsigned long long) (n), \
+                       __ATOMIC_RELAXED)
+
+/* Start and stop the reporter thread. */
+void progress_init(void);
+void progress_shutdown(void);
+
+/*
+ * Mark the start and the end of a test.  progress_end() erases whatever
+ * the reporter printed, so that the caller can print the result.
+ */
+void progress_begin(int test);
+void progress_end(void);
+
+#endif
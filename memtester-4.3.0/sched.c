@@ -0,0 +1,185 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the time budget scheduler (-b).  A production gate
+ * gives every board a fixed time, and the fixed test order can spend all
+ * of it in Block Sequential.  The scheduler runs the tests in the order of
+ * their detection yield per second (failures per run over time per run),
+ * learnt across runs and kept in a small state file, so that a bad board
+ * reaches its first failure as soon as possible.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "sched.h"
+
+/* Key of the history entries, the list is told apart by a 'D' or 'S'. */
+#define SCHED_NAME_MAX 48
+
+struct sched_entry {
+    char mode;
+    char name[SCHED_NAME_MAX];
+    ul runs;
+    ul failures;
+    double seconds_per_mb;  /* average, 0 if unknown */
+};
+
+double memtester_budget = 0;
+
+static struct test *sched_list;
+static char sched_mode;
+static const char *sched_path;
+static double sched_rate;
+
+/* The tests of the list first, then the entries of the other list. */
+static struct sched_entry entries[MAX_TESTS * 2];
+static int nentries, ntests;
+
+static struct sched_entry *find_entry(char mode, const char *name) {
+    int i;
+
+    for (i = 0; i < nentries; i++) {
+        if (entries[i].mode == mode && strcmp(entries[i].name, name) == 0)
+            return &entries[i];
+    }
+    return NULL;
+}
+
+void sched_init(struct test *list, int single, const char *path,
+                double rate) {
+    struct sched_entry e, *p;
+    char line[128];
+    FILE *f;
+
+    sched_list = list;
+    sched_mode = single ? 'S' : 'D';
+    sched_path = path;
+    sched_rate = rate;
+    for (ntests = 0; list[ntests].name && ntests < MAX_TESTS; ntests++) {
+        memset(&entries[ntests], 0, sizeof(entries[ntests]));
+        entries[ntests].mode = sched_mode;
+        snprintf(entries[ntests].name, SCHED_NAME_MAX, "%s",
+                 list[ntests].name);
+    }
+    nentries = ntests;
+
+    if (!path || !(f = fopen(path, "r")))
+        return;
+    /* runs failures seconds_per_mb mode name */
+    while (fgets(line, sizeof(line), f)) {
+        memset(&e, 0, sizeof(e));
+        if (sscanf(line, "%lu %lu %lf %c %47[^\n]", &e.runs, &e.failures,
+                   &e.seconds_per_mb, &e.mode, e.name) != 5)
+            continue;
+        if ((p = find_entry(e.mode, e.name))) {
+            *p = e;
+        } else if (nentries < MAX_TESTS * 2) {
+            entries[nentries++] = e;
+        }
+    }
+    fclose(f);
+}
+
+double sched_estimate(int test, ull region) {
+    struct sched_entry *e = &entries[test];
+    struct test *t = &sched_list[test];
+
+    if (e->runs && e->seconds_per_mb > 0)
+        return e->seconds_per_mb * region / (1 << 20);
+    if (sched_rate <= 0)
+        return 0;
+    return (double) region * (t->writes + t->reads) / sched_rate;
+}
+
+/*
+ * Detection yield per second.  The failure rate starts at 1/2 and is
+ * smoothed with one success and one failure (Laplace), so that a test
+ * which has not failed yet is not dropped for good.  The time is per MB,
+ * the yields are only compared with each other.
+ */
+static double yield(int test) {
+    struct sched_entry *e = &entries[test];
+    double p = (e->failures + 1.0) / (e->runs + 2.0);
+    double t = sched_estimate(test, 1 << 20);
+
+    return t > 0 ? p / t : p;
+}
+
+int sched_order(int *order, ull mask, int first_loop) {
+    int i, j, n = 0, cheapest = -1, tmp;
+
+    for (i = 0; i < ntests; i++) {
+        if (!mask || (mask & (1ULL << i)))
+            order[n++] = i;
+    }
+    if (!memtester_budget)
+        return n;
+
+    /* Insertion sort, the lists are short. */
+    for (i = 1; i < n; i++) {
+        for (j = i; j > 0 && yield(order[j]) > yield(order[j - 1]); j--) {
+            tmp = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = tmp;
+        }
+    }
+    if (first_loop) {
+        for (i = 0; i < n; i++) {
+            if (cheapest < 0 || sched_estimate(order[i], 1 << 20) <
+                                sched_estimate(order[cheapest], 1 << 20))
+                cheapest = i;
+        }
+        for (i = cheapest; i > 0; i--) {
+            tmp = order[i];
+            order[i] = order[i - 1];
+            order[i - 1] = tmp;
+        }
+    }
+    return n;
+}
+
+void sched_record(int test, ull region, double seconds, int failed) {
+    struct sched_entry *e = &entries[test];
+    double spmb = region ? seconds * (1 << 20) / region : 0;
+
+    /* A failing test bails out early, its time is not representative. */
+    if (!failed && spmb > 0) {
+        e->seconds_per_mb = e->seconds_per_mb > 0
+                            ? (e->seconds_per_mb * 3 + spmb) / 4 : spmb;
+    }
+    e->runs++;
+    e->failures += failed != 0;
+}
+
+int sched_save(void) {
+    char tmp[4096];
+    FILE *f;
+    int i;
+
+    if (!sched_path)
+        return 0;
+    snprintf(tmp, sizeof(tmp), "%s.tmp", sched_path);
+    if (!(f = fopen(tmp, "w")))
+        return -1;
+    for (i = 0; i < nentries; i++) {
+        fprintf(f, "%lu %lu %.9f %c %s\n", entries[i].runs,
+                entries[i].failures, entries[i].seconds_per_mb,
+                entries[i].mode, entries[i].name);
+    }
+    if (fclose(f) != 0 || rename(tmp, sched_path) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
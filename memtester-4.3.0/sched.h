@@ -0,0 +1,52 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the time budget scheduler.
+ *
+ */
+
+#ifndef MEMTESTER_SCHED_H
+#define MEMTESTER_SCHED_H
+
+#define SCHED_STATE_FILE_DEFAULT "/var/tmp/memtester.state"
+
+struct test;
+
+/* Wall-clock budget in seconds (-b), 0 to run the tests in list order. */
+extern double memtester_budget;
+
+/*
+ * Load the detection history of the tests in 'list' from 'path' (a
+ * missing file is an empty history, NULL keeps no history).  'single'
+ * tells the -S list apart, 'rate' is the measured bandwidth in bytes per
+ * second, used to estimate the time of the tests without a history.
+ */
+void sched_init(struct test *list, int single, const char *path,
+                double rate);
+
+/*
+ * Fill 'order' with the indexes of the tests selected by 'mask' (0 for
+ * all) in the order to run them and return their number.  With a budget,
+ * the tests are ordered by detection yield per second; in the first loop
+ * the cheapest test goes first, as a quick sweep over the whole buffer.
+ */
+int sched_order(int *order, unsigned long long mask, int first_loop);
+
+/* Estimated time of one run of test 'test' over 'region' bytes. */
+double sched_estimate(int test, unsigned long long region);
+
+/* Add a run of test 'test' to the history. */
+void sched_record(int test, unsigned long long region, double seconds,
+                  int failed);
+
+/* Write the history back to the state file.  Returns 0 on success. */
+int sched_save(void);
+
+#endif
@@ -14,7 +14,9 @@
 
 #include <limits.h>
 
-#define rand32() ((unsigned int) rand() | ( (unsigned int) rand() << 16))
+#include "prng.h"
+
+#define rand32() ((unsigned int) prng_next(prng_stream()))
 
 #if (ULONG_MAX == 4294967295UL)
     #define rand_ul() rand32()
@@ -24,7 +26,7 @@
     #define CHECKERBOARD2 0xaaaaaaaa
     #define UL_BYTE(x) ((x | x << 8 | x << 16 | x << 24))
 #elif (ULONG_MAX == 18446744073709551615ULL)
-    #define rand64() (((ul) rand32()) << 32 | ((ul) rand32()))
+    #define rand64() ((ul) prng_next(prng_stream()))
     #define rand_ul() rand64()
     #define UL_ONEBITS 0xffffffffffffffffUL
     #define UL_LEN 64
@@ -0,0 +1,100 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the per-test timing statistics.  Every test gets its
+ * wall time and memory traffic recorded, the bandwidth of its first loop
+ * is the baseline, and later loops which are much slower (throttling,
+ * DVFS, GPU contention) are flagged.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "types.h"
+#include "stats.h"
+
+struct test_stats {
+    const char *name;
+    int ran;            /* in the current loop */
+    double seconds;
+    ull written;
+    ull read;
+    double baseline;    /* GB/s of the first loop, 0 if not yet known */
+};
+
+unsigned int memtester_slowdown_percent = SLOWDOWN_PERCENT_DEFAULT;
+
+static struct test_stats stats[STATS_MAX_TESTS];
+static FILE *csv;
+
+int stats_open(const char *path) {
+    csv = strcmp(path, "-") == 0 ? stdout : fopen(path, "a");
+    if (!csv)
+        return -1;
+    fprintf(csv, "loop,test,seconds,bytes_written,bytes_read,gbps,"
+            "baseline_gbps,slower\n");
+    fflush(csv);
+    return 0;
+}
+
+void stats_record(int test, const char *name, double seconds, ull written,
+                  ull read) {
+    struct test_stats *s;
+
+    if (test < 0 || test >= STATS_MAX_TESTS)
+        return;
+    s = &stats[test];
+    s->name = name;
+    s->ran = 1;
+    s->seconds = seconds;
+    s->written = written;
+    s->read = read;
+}
+
+static double gbps(const struct test_stats *s) {
+    return s->seconds > 0 ? (s->written + s->read) / s->seconds / 1e9 : 0;
+}
+
+int stats_loop_end(ul loop) {
+    struct test_stats *s;
+    double rate;
+    int i, slower, nslower = 0, header = 0;
+
+    for (i = 0; i < STATS_MAX_TESTS; i++) {
+        s = &stats[i];
+        if (!s->ran)
+            continue;
+        if (!header++) {
+            printf("  %-20s %9s %10s %10s %8s\n", "Test", "seconds",
+                   "written", "read", "GB/s");
+        }
+        rate = gbps(s);
+        if (!s->baseline)
+            s->baseline = rate;
+        slower = s->baseline > 0 &&
+                 rate < s->baseline * (100 - memtester_slowdown_percent) / 100;
+        nslower += slower;
+        printf("  %-20s %9.3f %8lluMB %8lluMB %8.2f", s->name, s->seconds,
+               s->written >> 20, s->read >> 20, rate);
+        if (slower)
+            printf("  SLOWER, %.0f%% below the first run",
+                   100 * (1 - rate / s->baseline));
+        printf("\n");
+        if (csv)
+            fprintf(csv, "%lu,\"%s\",%.6f,%llu,%llu,%.4f,%.4f,%d\n", loop,
+                    s->name, s->seconds, s->written, s->read, rate,
+                    s->baseline, slower);
+        s->ran = 0;
+    }
+    if (csv)
+        fflush(csv);
+    return nslower;
+}
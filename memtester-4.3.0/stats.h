@@ -0,0 +1,43 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the per-test timing statistics.
+ *
+ */
+
+#ifndef MEMTESTER_STATS_H
+#define MEMTESTER_STATS_H
+
+#define STATS_MAX_TESTS 64
+#define SLOWDOWN_PERCENT_DEFAULT 10
+
+/*
+ * A test is flagged when its bandwidth drops by more than this many
+ * percent below its first loop.
+ */
+extern unsigned int memtester_slowdown_percent;
+
+/*
+ * Append the records as CSV lines to 'path' ("-" for stdout).  Returns 0
+ * on success.
+ */
+int stats_open(const char *path);
+
+/* Record one passing run of test 'test' (its index in the test list). */
+void stats_record(int test, const char *name, double seconds,
+                  unsigned long long written, unsigned long long read);
+
+/*
+ * Print the table of the tests run during 'loop', write their CSV lines
+ * and start a new loop.  Returns the number of tests flagged as slower.
+ */
+int stats_loop_end(unsigned long loop);
+
+#endif
@@ -17,172 +17,544 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <unistd.h>
+#include <time.h>
 
 #include "types.h"
 #include "sizes.h"
 #include "memtester.h"
+#include "threads.h"
+#include "kernels.h"
+#include "cache.h"
+#include "errmap.h"
+#include "dram.h"
+#include "pagemap.h"
+#include "progress.h"
+#include "focus.h"
+#include "evlog.h"
+#include "order.h"
 
-char progress[] = "-\\|/";
-#define PROGRESSLEN 4
 #define PROGRESSOFTEN 2500
 #define ONE 0x00000001L
+#define RANDOM_CHUNK 256 /* words generated at once by test_random_value */
+#define CONFIRM_WINDOW 64 /* words re-read on each side of a mismatch */
+#define CONFIRM_READS 4   /* confirmation reads of a mismatch */
+#define ERRMAP_BLOCK 256  /* words compared at once when collecting errors */
+#define MOVINV_BLOCK 512  /* words per segment of the moving inversions */
+#define MOVINV_PATTERNS 10
+#define MODULO_N 20
+#define MODULO_BLOCK 640  /* words per segment of the modulo-N test */
+#define REPORT_RATE_DEFAULT 10 /* failures printed per second with -C */
+
+/*
+ * After a failing verify pass: give up on the test, or with -C note the
+ * failure in 'failed' and run the test to completion.
+ */
+#define fail_or_continue(failed)    \
+    do {                            \
+        if (!memtester_continue)    \
+            return -1;              \
+        (failed) = -1;              \
+    } while (0)
 
 /* Function definitions. */
 
-int memtester_has_found_errors = 0;
+/*
+ * With -N, write the data just stored back to DRAM and drop it from the
+ * caches, so that the verify which follows reads DRAM even when the
+ * buffer fits in the last level cache.
+ */
+static void bypass_caches(ulv *buf, size_t count) {
+    if (memtester_bypass && buf)
+        cache_flush_range(buf, count * sizeof(ul));
+}
 
-#ifdef __arm__
-typedef struct compare_regions_helper_result {
-    ul failed_index[8];
-    ul failed_value1[8];
-    ul failed_value2[8];
-} compare_regions_helper_result;
+int memtester_has_found_errors = 0;
 
-void compare_regions_helper_neon(ulv *buf1, ulv *buf2, ul count,
-                                 compare_regions_helper_result *res);
-#endif
+/* Test options, set from the command line by memtester.c. */
+size_t memtester_pipeline_lag = 0; /* bytes, 0 if -P is not used */
+int memtester_continue = 0; /* -C, run the tests to completion */
+unsigned int memtester_report_rate = REPORT_RATE_DEFAULT; /* lines/s with -C */
+int memtester_bypass = 0; /* -N, for the test running now */
 
-size_t compare_regions_helper(ulv *bufa, ulv *bufb, size_t count, ul *va, ul *vb) {
-    size_t i, result = (size_t)(-1);
-    ulv *p1 = bufa;
-    ulv *p2 = bufb;
+static ull reports_suppressed;
 
-#ifdef __arm__
-    if (count >= 16) {
-        int j;
-        int best_j = 0;
-        compare_regions_helper_result res;
-        compare_regions_helper_neon(bufa, bufb, count, &res);
-        for (j = 0; j < 8; j++) {
-            if (res.failed_index[j] == 0xFFFFFFFF)
-                continue;
-            if (res.failed_index[best_j] == 0xFFFFFFFF)
-                best_j = j;
-            if (res.failed_index[j] > res.failed_index[best_j]) {
-                best_j = j;
-            }
-        }
-        if (res.failed_index[best_j] != 0xFFFFFFFF) {
-            *va = res.failed_value1[best_j];
-            *vb = res.failed_value2[best_j];
-            return res.failed_index[best_j];
-        }
-        return (size_t)(-1);
+/* Print how many failure reports were held back.  Report lock held. */
+static void report_suppressed(void) {
+    if (reports_suppressed) {
+        fprintf(stderr, "  (%llu failure reports suppressed, see the "
+                "error map)\n", reports_suppressed);
+        reports_suppressed = 0;
     }
-#endif
+}
 
-    for (i = 0; i < count; i++, p1++, p2++) {
-        ul v1 = *p1, v2 = *p2;
-        if (v1 != v2) {
-            *va = v1;
-            *vb = v2;
-            result = i;
-        }
+/*
+ * With -C, failures are printed at most memtester_report_rate times per
+ * second, and a word is only printed the first time it fails; the error
+ * map collects them all.  Returns non-zero if the failure at 'offset' may
+ * be printed, (size_t) -1 standing for the "... and N more" line which
+ * follows it.  Called with the report lock held.
+ */
+int report_allowed(size_t offset) {
+    static time_t second;
+    static unsigned int printed;
+    static int last = 1;
+    time_t now;
+
+    if (!memtester_continue)
+        return 1;
+    if (offset == (size_t) -1)
+        return last;
+    last = 0;
+    if (errmap_word_count(offset) > 1) {
+        reports_suppressed++;
+        return 0;
+    }
+    now = time(NULL);
+    if (now != second) {
+        report_suppressed();
+        second = now;
+        printed = 0;
+    }
+    if (printed >= memtester_report_rate) {
+        reports_suppressed++;
+        return 0;
     }
-    return result;
+    printed++;
+    last = 1;
+    return 1;
 }
 
-int compare_regions(const char *tname, ulv *bufa, ulv *bufb, size_t count) {
-    size_t i;
-    off_t physaddr;
-    size_t index1, index2;
-    ul v1a, v1b, v2a, v2b;
-    ul write_error = 0;
+void report_flush(void) {
+    memtester_report_lock();
+    report_suppressed();
+    memtester_report_unlock();
+}
 
-    index1 = compare_regions_helper(bufa, bufb, count, &v1a, &v1b);
-    if (index1 == (size_t)(-1))
-        return 0;
+size_t compare_regions_helper(ulv *bufa, ulv *bufb, size_t count, ul *va, ul *vb) {
+    return compare_regions_kernel(bufa, bufb, count, va, vb);
+}
 
-    /* second pass to confirm if the results are the same */
-    index2 = compare_regions_helper(bufa, bufb, count, &v2a, &v2b);
+/*
+ * Print a failure.  'offset' is in bytes from the start of bufa (or of the
+ * whole region for the single buffer tests), stripe offsets included.
+ */
+void report_failure(const char *kind, const char *tname, size_t offset,
+                    ul v1, ul v2) {
+    off_t physaddr;
+    ull phys;
 
+    memtester_report_lock();
+    memtester_last_failure.offset = offset;
+    memtester_last_failure.flipped = v1 ^ v2;
+    if (memtester_focusing) {
+        memtester_report_unlock();
+        return;
+    }
+    evlog_event(evlog_kind(kind), offset, v2, v1);
     memtester_has_found_errors = 1;
+    if (!report_allowed(offset)) {
+        memtester_report_unlock();
+        return;
+    }
     if (use_phys) {
-        physaddr = physaddrbase + (ul)(index1 * sizeof(ul));
+        physaddr = physaddrbase + (ul) offset;
         fprintf(stderr, 
                 "%s FAILURE: 0x%08lx != 0x%08lx at physical address "
                 "0x%08lx (%s).\n",
-                index1 == index2 ? "WRITE" : "READ",
-                v1a, v1b, physaddr, tname);
+                kind, v1, v2, physaddr, tname);
+    } else if (pagemap_lookup(offset, &phys) == 0) {
+        fprintf(stderr, 
+                "%s FAILURE: 0x%08lx != 0x%08lx at offset 0x%08lx, "
+                "physical address 0x%09llx (%s).\n",
+                kind, v1, v2, (ul) offset, phys, tname);
     } else {
         fprintf(stderr, 
                 "%s FAILURE: 0x%08lx != 0x%08lx at offset 0x%08lx (%s).\n",
-                index1 == index2 ? "WRITE" : "READ",
-                v1a, v1b, (ul)(index1 * sizeof(ul)), tname);
+                kind, v1, v2, (ul) offset, tname);
     }
     fflush(stderr);
-    fsync(fileno(stderr));
+    /* The event log is written back by its own thread. */
+    if (!evlog_active())
+        fsync(fileno(stderr));
+    memtester_report_unlock();
     if (memtester_early_exit)
         exit(4);
+}
+
+/*
+ * Classify a failure from the number of confirmation reads which still saw
+ * the wrong value: all of them means the wrong value is stored in memory,
+ * none means only the first read was bad.
+ */
+static const char *failure_kind(int bad) {
+    if (bad == CONFIRM_READS)
+        return "WRITE";
+    return bad ? "INTERMITTENT" : "READ";
+}
+
+/*
+ * Re-read the window of words around a mismatch at 'index', flushing it out
+ * of the caches before each read so that the values come from DRAM again.
+ * Returns the number of reads for which the words at 'index' still differ.
+ */
+static int confirm_mismatch(ulv *bufa, ulv *bufb, size_t count,
+                            size_t index) {
+    size_t lo = index > CONFIRM_WINDOW ? index - CONFIRM_WINDOW : 0;
+    size_t hi = count - index > CONFIRM_WINDOW ? index + CONFIRM_WINDOW + 1
+                                               : count;
+    size_t i;
+    ul a, b;
+    int r, bad = 0;
+
+    for (r = 0; r < CONFIRM_READS; r++) {
+        cache_flush_range(bufa + lo, (hi - lo) * sizeof(ul));
+        cache_flush_range(bufb + lo, (hi - lo) * sizeof(ul));
+        /* The whole window is read, in order, as the full compare did. */
+        for (i = lo; i < hi; i++) {
+            a = bufa[i];
+            b = bufb[i];
+            if (i == index && a != b)
+                bad++;
+        }
+    }
+    return bad;
+}
+
+/*
+ * 'offset' is the position of bufa in bytes, used for reporting.  The
+ * buffers are compared in blocks with the SIMD kernel, and only the blocks
+ * holding a mismatch are scanned again word by word, so every mismatch
+ * goes to the error map at streaming speed.  The first one is reported.
+ * If 'order' is not NULL, its blocks are compared in its order.
+ *
+ * If 'expect' is not NULL, it holds the pattern written at the even and
+ * odd indexes, and a mismatch is put on the buffer which lost it.
+ * Otherwise nothing tells which side is wrong, and bufa gets the blame.
+ */
+static int compare_regions_at(const char *tname, ulv *bufa, ulv *bufb,
+                              size_t count, size_t offset,
+                              const memtester_order_t *order,
+                              const ul *expect) {
+    size_t c, i, k, n, first = 0, first_offset = 0, bad_offset, nbad = 0;
+    size_t chunk = order ? order->block : ERRMAP_BLOCK;
+    ul a, b, v1 = 0, v2 = 0;
+    int bad_b;
+
+    progress_bytes(2 * count * sizeof(ul));
+    for (c = 0; c * chunk < count; c++) {
+        i = order ? order_block(order, c) : c * chunk;
+        n = count - i < chunk ? count - i : chunk;
+        if (compare_regions_helper(bufa + i, bufb + i, n, &a, &b) ==
+            (size_t)(-1))
+            continue;
+        for (k = i; k < i + n; k++) {
+            a = bufa[k];
+            b = bufb[k];
+            if (a == b)
+                continue;
+            bad_b = expect && a == expect[k & 1];
+            bad_offset = offset +
+                         (size_t) ((bad_b ? bufb : bufa) + k - bufa) *
+                         sizeof(ul);
+            errmap_record(tname, bad_offset, bad_b ? a : b, bad_b ? b : a);
+            if (!nbad++) {
+                first = k;
+                first_offset = bad_offset;
+                v1 = bad_b ? b : a;
+                v2 = bad_b ? a : b;
+            }
+        }
+    }
+    if (!nbad)
+        return 0;
+    if (!expect)
+        dram_count_unsided(nbad);
+
+    report_failure(failure_kind(confirm_mismatch(bufa, bufb, count, first)),
+                   tname, first_offset, v1, v2);
+    if (nbad > 1 && !memtester_focusing) {
+        memtester_report_lock();
+        if (report_allowed((size_t) -1)) {
+            fprintf(stderr, "  ... and %llu more mismatching words (%s).\n",
+                    (ull) nbad - 1, tname);
+        }
+        memtester_report_unlock();
+    }
 
     /* printf("Skipping to next test..."); */
     return -1;
 }
 
+/* With -R, the verify visits the blocks in another order than the fill. */
+static int compare_expected(const char *tname, ulv *bufa, ulv *bufb,
+                            size_t count, const ul *expect) {
+    memtester_order_t order;
+
+    bypass_caches(bufa, count);
+    bypass_caches(bufb, count);
+    if (memtester_random_order)
+        order_init(&order, count, rand_ul());
+    return compare_regions_at(tname, bufa, bufb, count,
+                              memtester_stripe_offset,
+                              memtester_random_order ? &order : NULL, expect);
+}
+
+int compare_regions(const char *tname, ulv *bufa, ulv *bufb, size_t count) {
+    return compare_expected(tname, bufa, bufb, count, NULL);
+}
+
+/* Compare buffers filled by fill_pattern(bufa, bufb, count, even, odd). */
+static int compare_pattern(const char *tname, ulv *bufa, ulv *bufb,
+                           size_t count, ul even, ul odd) {
+    ul expect[2];
+
+    expect[0] = even;
+    expect[1] = odd;
+    return compare_expected(tname, bufa, bufb, count, expect);
+}
+
+/* Like fill_regions(), but block by block in a random order with -R. */
+static void fill_pattern(ulv *bufa, ulv *bufb, size_t count, ul even, ul odd) {
+    memtester_order_t order;
+    size_t c, i, n;
+
+    if (!memtester_random_order) {
+        fill_regions(bufa, bufb, count, even, odd);
+        return;
+    }
+    order_init(&order, count, rand_ul());
+    for (c = 0; c < order.nblocks; c++) {
+        /* Blocks start at even indexes, the pattern stays in phase. */
+        i = order_block(&order, c);
+        n = count - i < order.block ? count - i : order.block;
+        fill_regions(bufa + i, bufb + i, n, even, odd);
+    }
+}
+
+/*
+ * Pipelined executor for the fill-then-compare pattern tests (-P).  The
+ * buffers are processed in chunks and the patterns are streamed through
+ * them: chunk k of pattern j is verified 'lag' chunks after it was written,
+ * while the following chunks (and the start of pattern j + 1) are being
+ * written.  The lag covers more than the caches, so the verify always
+ * reads the data back from DRAM, and every pattern costs one combined
+ * write+verify sweep instead of a write pass followed by a compare pass.
+ */
+#define PIPELINE_CHUNK 2048 /* words */
+
+typedef void (*pattern_fn)(unsigned int j, ul *even, ul *odd);
+
+static int run_pattern_pipeline(const char *tname, ulv *bufa, ulv *bufb,
+                                size_t count, unsigned int npatterns,
+                                pattern_fn pattern) {
+    size_t nchunks = (count + PIPELINE_CHUNK - 1) / PIPELINE_CHUNK;
+    size_t lag = (memtester_pipeline_lag + 2 * PIPELINE_CHUNK * sizeof(ul) - 1)
+                 / (2 * PIPELINE_CHUNK * sizeof(ul));
+    size_t step, total = nchunks * npatterns, c, n;
+    unsigned int j;
+    ul even, odd, expect[2];
+    int failed = 0;
+
+    /*
+     * Chunk k of pattern j + 1 must not be written before chunk k of
+     * pattern j is verified.
+     */
+    if (lag >= nchunks)
+        return 1;
+
+    for (step = 0; step < total + lag; step++) {
+        if (step < total) {
+            j = step / nchunks;
+            c = step % nchunks;
+            if (c == 0) {
+                progress_phase("setting", j);
+            }
+            n = c == nchunks - 1 ? count - c * PIPELINE_CHUNK : PIPELINE_CHUNK;
+            pattern(j, &even, &odd);
+            fill_regions(bufa + c * PIPELINE_CHUNK, bufb + c * PIPELINE_CHUNK,
+                         n, even, odd);
+        }
+        if (step >= lag) {
+            c = (step - lag) % nchunks;
+            n = c == nchunks - 1 ? count - c * PIPELINE_CHUNK : PIPELINE_CHUNK;
+            pattern((unsigned int) ((step - lag) / nchunks), &expect[0],
+                    &expect[1]);
+            if (compare_regions_at(tname, bufa + c * PIPELINE_CHUNK,
+                                   bufb + c * PIPELINE_CHUNK, n,
+                                   memtester_stripe_offset +
+                                   c * PIPELINE_CHUNK * sizeof(ul), NULL,
+                                   expect)) {
+                fail_or_continue(failed);
+            }
+        }
+    }
+    return failed;
+}
+
+/*
+ * Run a pattern test through the pipeline if it is enabled and the buffer
+ * is large enough.  Returns 1 if the caller should use the plain loop.
+ * The pipeline walks the chunks in order, -R takes precedence.
+ */
+static int try_pattern_pipeline(const char *tname, ulv *bufa, ulv *bufb,
+                                size_t count, unsigned int npatterns,
+                                pattern_fn pattern) {
+    if (!memtester_pipeline_lag || memtester_random_order)
+        return 1;
+    return run_pattern_pipeline(tname, bufa, bufb, count, npatterns, pattern);
+}
+
+/* Print an address line failure, the word at 'offset' being where it showed. */
+static int address_line_failure(const char *what, unsigned int line,
+                                unsigned int other, size_t offset) {
+    ull phys;
+
+    memtester_report_lock();
+    memtester_has_found_errors = 1;
+    if (other)
+        fprintf(stderr, "FAILURE: address line %u %s with line %u", line,
+                what, other);
+    else
+        fprintf(stderr, "FAILURE: address line %u %s", line, what);
+    if (use_phys) {
+        fprintf(stderr, " at physical address 0x%08lx.\n",
+                (ul) (physaddrbase + offset));
+    } else if (pagemap_lookup(offset, &phys) == 0) {
+        fprintf(stderr, " at physical address 0x%09llx.\n", phys);
+    } else {
+        fprintf(stderr, " at offset 0x%08lx.\n", (ul) offset);
+    }
+    fflush(stderr);
+    memtester_report_unlock();
+    if (memtester_early_exit)
+        exit(4);
+    return -1;
+}
+
+/* Write back the words touched by test_address_lines(), so the next reads
+   come from DRAM and not from the cache, which would hide any aliasing.
+   All of them go in one call, on 32-bit ARM each call is a full eviction. */
+static void flush_address_lines(ulv *buf, size_t count) {
+    void volatile *words[sizeof(size_t) * CHAR_BIT + 1];
+    size_t offset, n = 0;
+
+    words[n++] = buf;
+    for (offset = 1; offset < count; offset <<= 1)
+        words[n++] = buf + offset;
+    cache_flush_list(words, n);
+}
+
+/*
+ * Walk the address lines with power-of-two offsets.  A line stuck low
+ * makes the word at its offset alias the first word, a line stuck high
+ * makes the first word alias its offset, and two shorted lines make their
+ * offsets alias each other.  Only a few words per line are touched, so
+ * this takes milliseconds where test_stuck_address() sweeps the buffer 16
+ * times.  'line' is the bit of the byte address, counted from 0.
+ */
+int test_address_lines(ulv *buf, size_t count) {
+    unsigned int shift = __builtin_ctzl(sizeof(ul));
+    size_t offset, test;
+
+    for (offset = 1; offset < count; offset <<= 1)
+        buf[offset] = CHECKERBOARD1;
+    buf[0] = CHECKERBOARD2;
+    flush_address_lines(buf, count);
+    for (offset = 1; offset < count; offset <<= 1) {
+        if (buf[offset] != CHECKERBOARD1) {
+            return address_line_failure("stuck low", shift +
+                                        __builtin_ctzl(offset), 0,
+                                        offset * sizeof(ul));
+        }
+    }
+
+    buf[0] = CHECKERBOARD1;
+    for (test = 1; test < count; test <<= 1) {
+        buf[test] = CHECKERBOARD2;
+        flush_address_lines(buf, count);
+        if (buf[0] != CHECKERBOARD1) {
+            return address_line_failure("stuck high", shift +
+                                        __builtin_ctzl(test), 0, 0);
+        }
+        for (offset = 1; offset < count; offset <<= 1) {
+            if (offset != test && buf[offset] != CHECKERBOARD1) {
+                return address_line_failure("shorted",
+                                            shift + __builtin_ctzl(test),
+                                            shift + __builtin_ctzl(offset),
+                                            offset * sizeof(ul));
+            }
+        }
+        buf[test] = CHECKERBOARD1;
+    }
+    return 0;
+}
+
 int test_stuck_address(ulv *bufa, size_t count) {
     ulv *p1 = bufa;
     unsigned int j;
     size_t i;
     off_t physaddr;
+    ull phys;
 
-    printf("           ");
-    fflush(stdout);
     for (j = 0; j < 16; j++) {
-        printf("\b\b\b\b\b\b\b\b\b\b\b");
         p1 = (ulv *) bufa;
-        printf("setting %3u", j);
-        fflush(stdout);
+        progress_phase("setting", j);
         for (i = 0; i < count; i++) {
             *p1 = ((j + i) % 2) == 0 ? (ul) p1 : ~((ul) p1);
             *p1++;
         }
-        printf("\b\b\b\b\b\b\b\b\b\b\b");
-        printf("testing %3u", j);
-        fflush(stdout);
+        memtester_sync();
+        progress_phase("testing", j);
         p1 = (ulv *) bufa;
         for (i = 0; i < count; i++, p1++) {
             if (*p1 != (((j + i) % 2) == 0 ? (ul) p1 : ~((ul) p1))) {
+                memtester_report_lock();
                 if (use_phys) {
-                    physaddr = physaddrbase + (i * sizeof(ul));
+                    physaddr = physaddrbase + memtester_stripe_offset +
+                               (i * sizeof(ul));
                     fprintf(stderr, 
                             "FAILURE: possible bad address line at physical "
                             "address 0x%08lx.\n", 
                             physaddr);
+                } else if (pagemap_lookup(memtester_stripe_offset +
+                                          i * sizeof(ul), &phys) == 0) {
+                    fprintf(stderr, 
+                            "FAILURE: possible bad address line at physical "
+                            "address 0x%09llx.\n", 
+                            phys);
                 } else {
                     fprintf(stderr, 
                             "FAILURE: possible bad address line at offset "
                             "0x%08lx.\n", 
-                            (ul) (i * sizeof(ul)));
+                            (ul) (memtester_stripe_offset +
+                                  i * sizeof(ul)));
                 }
                 printf("Skipping to next test...\n");
                 fflush(stdout);
+                memtester_report_unlock();
                 return -1;
             }
         }
     }
-    printf("\b\b\b\b\b\b\b\b\b\b\b           \b\b\b\b\b\b\b\b\b\b\b");
-    fflush(stdout);
     return 0;
 }
 
 int test_random_value(ulv *bufa, ulv *bufb, size_t count) {
-    ulv *p1 = bufa;
-    ulv *p2 = bufb;
+    ul chunk[RANDOM_CHUNK];
     ul j = 0;
-    size_t i;
+    size_t i, n;
 
-    putchar(' ');
-    fflush(stdout);
-    for (i = 0; i < count; i++) {
-        *p1++ = *p2++ = rand_ul();
-        if (!(i % PROGRESSOFTEN)) {
-            putchar('\b');
-            putchar(progress[++j % PROGRESSLEN]);
-            fflush(stdout);
+    for (i = 0; i < count; i += n) {
+        n = count - i < RANDOM_CHUNK ? count - i : RANDOM_CHUNK;
+        prng_fill(chunk, n);
+        copy_region(bufa + i, chunk, n);
+        copy_region(bufb + i, chunk, n);
+        if (!(i % (RANDOM_CHUNK * 16))) {
+            progress_spin(++j);
         }
     }
-    printf("\b \b");
-    fflush(stdout);
+    memtester_sync();
     return compare_regions("random_value", bufa, bufb, count);
 }
 
@@ -196,6 +568,7 @@ int test_xor_comparison(ulv *bufa, ulv *bufb, size_t count) {
         *p1++ ^= q;
         *p2++ ^= q;
     }
+    memtester_sync();
     return compare_regions("xor", bufa, bufb, count);
 }
 
@@ -209,6 +582,7 @@ int test_sub_comparison(ulv *bufa, ulv *bufb, size_t count) {
         *p1++ -= q;
         *p2++ -= q;
     }
+    memtester_sync();
     return compare_regions("sub", bufa, bufb, count);
 }
 
@@ -222,22 +596,21 @@ int test_mul_comparison(ulv *bufa, ulv *bufb, size_t count) {
         *p1++ *= q;
         *p2++ *= q;
     }
+    memtester_sync();
     return compare_regions("mul", bufa, bufb, count);
 }
 
 int test_div_comparison(ulv *bufa, ulv *bufb, size_t count) {
-    ulv *p1 = bufa;
-    ulv *p2 = bufb;
-    size_t i;
+    memtester_divisor_t d;
     ul q = rand_ul();
 
-    for (i = 0; i < count; i++) {
-        if (!q) {
-            q++;
-        }
-        *p1++ /= q;
-        *p2++ /= q;
+    if (!q) {
+        q++;
     }
+    /* A real division per word would make this test CPU bound. */
+    divisor_init(&d, q);
+    div_regions(bufa, bufb, count, &d);
+    memtester_sync();
     return compare_regions("div", bufa, bufb, count);
 }
 
@@ -251,6 +624,7 @@ int test_or_comparison(ulv *bufa, ulv *bufb, size_t count) {
         *p1++ |= q;
         *p2++ |= q;
     }
+    memtester_sync();
     return compare_regions("or", bufa, bufb, count);
 }
 
@@ -264,6 +638,7 @@ int test_and_comparison(ulv *bufa, ulv *bufb, size_t count) {
         *p1++ &= q;
         *p2++ &= q;
     }
+    memtester_sync();
     return compare_regions("and", bufa, bufb, count);
 }
 
@@ -276,249 +651,561 @@ int test_seqinc_comparison(ulv *bufa, ulv *bufb, size_t count) {
     for (i = 0; i < count; i++) {
         *p1++ = *p2++ = (i + q);
     }
+    memtester_sync();
     return compare_regions("seqinc", bufa, bufb, count);
 }
 
+static void solidbits_pattern(unsigned int j, ul *even, ul *odd) {
+    *even = (j % 2) == 0 ? UL_ONEBITS : 0;
+    *odd = ~*even;
+}
+
 int test_solidbits_comparison(ulv *bufa, ulv *bufb, size_t count) {
-    ulv *p1 = bufa;
-    ulv *p2 = bufb;
     unsigned int j;
     ul q;
-    size_t i;
+    int ret, failed = 0;
 
-    printf("           ");
-    fflush(stdout);
+    ret = try_pattern_pipeline("solidbits", bufa, bufb, count, 64,
+                               solidbits_pattern);
+    if (ret <= 0)
+        return ret;
     for (j = 0; j < 64; j++) {
-        printf("\b\b\b\b\b\b\b\b\b\b\b");
         q = (j % 2) == 0 ? UL_ONEBITS : 0;
-        printf("setting %3u", j);
-        fflush(stdout);
-        p1 = (ulv *) bufa;
-        p2 = (ulv *) bufb;
-        for (i = 0; i < count; i++) {
-            *p1++ = *p2++ = (i % 2) == 0 ? q : ~q;
-        }
-        printf("\b\b\b\b\b\b\b\b\b\b\b");
-        printf("testing %3u", j);
-        fflush(stdout);
-        if (compare_regions("solidbits", bufa, bufb, count)) {
-            return -1;
+        progress_phase("setting", j);
+        fill_pattern(bufa, bufb, count, q, ~q);
+        memtester_sync();
+        progress_phase("testing", j);
+        if (compare_pattern("solidbits", bufa, bufb, count, q, ~q)) {
+            fail_or_continue(failed);
         }
     }
-    printf("\b\b\b\b\b\b\b\b\b\b\b           \b\b\b\b\b\b\b\b\b\b\b");
-    fflush(stdout);
-    return 0;
+    return failed;
+}
+
+static void checkerboard_pattern(unsigned int j, ul *even, ul *odd) {
+    *even = (j % 2) == 0 ? CHECKERBOARD1 : CHECKERBOARD2;
+    *odd = ~*even;
 }
 
 int test_checkerboard_comparison(ulv *bufa, ulv *bufb, size_t count) {
-    ulv *p1 = bufa;
-    ulv *p2 = bufb;
     unsigned int j;
     ul q;
-    size_t i;
+    int ret, failed = 0;
 
-    printf("           ");
-    fflush(stdout);
+    ret = try_pattern_pipeline("checkerboard", bufa, bufb, count, 64,
+                               checkerboard_pattern);
+    if (ret <= 0)
+        return ret;
     for (j = 0; j < 64; j++) {
-        printf("\b\b\b\b\b\b\b\b\b\b\b");
         q = (j % 2) == 0 ? CHECKERBOARD1 : CHECKERBOARD2;
-        printf("setting %3u", j);
-        fflush(stdout);
-        p1 = (ulv *) bufa;
-        p2 = (ulv *) bufb;
-        for (i = 0; i < count; i++) {
-            *p1++ = *p2++ = (i % 2) == 0 ? q : ~q;
-        }
-        printf("\b\b\b\b\b\b\b\b\b\b\b");
-        printf("testing %3u", j);
-        fflush(stdout);
-        if (compare_regions("checkerboard", bufa, bufb, count)) {
-            return -1;
+        progress_phase("setting", j);
+        fill_pattern(bufa, bufb, count, q, ~q);
+        memtester_sync();
+        progress_phase("testing", j);
+        if (compare_pattern("checkerboard", bufa, bufb, count, q, ~q)) {
+            fail_or_continue(failed);
         }
     }
-    printf("\b\b\b\b\b\b\b\b\b\b\b           \b\b\b\b\b\b\b\b\b\b\b");
-    fflush(stdout);
-    return 0;
+    return failed;
+}
+
+static void blockseq_pattern(unsigned int j, ul *even, ul *odd) {
+    *even = *odd = (ul) UL_BYTE(j);
 }
 
 int test_blockseq_comparison(ulv *bufa, ulv *bufb, size_t count) {
-    ulv *p1 = bufa;
-    ulv *p2 = bufb;
     unsigned int j;
-    size_t i;
+    int ret, failed = 0;
 
-    printf("           ");
-    fflush(stdout);
+    ret = try_pattern_pipeline("blockseq", bufa, bufb, count, 256,
+                               blockseq_pattern);
+    if (ret <= 0)
+        return ret;
     for (j = 0; j < 256; j++) {
-        printf("\b\b\b\b\b\b\b\b\b\b\b");
-        p1 = (ulv *) bufa;
-        p2 = (ulv *) bufb;
-        printf("setting %3u", j);
-        fflush(stdout);
-        for (i = 0; i < count; i++) {
-            *p1++ = *p2++ = (ul) UL_BYTE(j);
-        }
-        printf("\b\b\b\b\b\b\b\b\b\b\b");
-        printf("testing %3u", j);
-        fflush(stdout);
-        if (compare_regions("blockseq", bufa, bufb, count)) {
-            return -1;
+        progress_phase("setting", j);
+        fill_pattern(bufa, bufb, count, (ul) UL_BYTE(j), (ul) UL_BYTE(j));
+        memtester_sync();
+        progress_phase("testing", j);
+        if (compare_pattern("blockseq", bufa, bufb, count, (ul) UL_BYTE(j),
+                            (ul) UL_BYTE(j))) {
+            fail_or_continue(failed);
         }
     }
-    printf("\b\b\b\b\b\b\b\b\b\b\b           \b\b\b\b\b\b\b\b\b\b\b");
-    fflush(stdout);
-    return 0;
+    return failed;
 }
 
 int test_walkbits0_comparison(ulv *bufa, ulv *bufb, size_t count) {
-    ulv *p1 = bufa;
-    ulv *p2 = bufb;
     unsigned int j;
-    size_t i;
+    ul q;
+    int failed = 0;
 
-    printf("           ");
-    fflush(stdout);
     for (j = 0; j < UL_LEN * 2; j++) {
-        printf("\b\b\b\b\b\b\b\b\b\b\b");
-        p1 = (ulv *) bufa;
-        p2 = (ulv *) bufb;
-        printf("setting %3u", j);
-        fflush(stdout);
-        for (i = 0; i < count; i++) {
-            if (j < UL_LEN) { /* Walk it up. */
-                *p1++ = *p2++ = ONE << j;
-            } else { /* Walk it back down. */
-                *p1++ = *p2++ = ONE << (UL_LEN * 2 - j - 1);
-            }
+        progress_phase("setting", j);
+        if (j < UL_LEN) { /* Walk it up. */
+            q = ONE << j;
+        } else { /* Walk it back down. */
+            q = ONE << (UL_LEN * 2 - j - 1);
         }
-        printf("\b\b\b\b\b\b\b\b\b\b\b");
-        printf("testing %3u", j);
-        fflush(stdout);
-        if (compare_regions("walkbits0", bufa, bufb, count)) {
-            return -1;
+        fill_pattern(bufa, bufb, count, q, q);
+        memtester_sync();
+        progress_phase("testing", j);
+        if (compare_pattern("walkbits0", bufa, bufb, count, q, q)) {
+            fail_or_continue(failed);
         }
     }
-    printf("\b\b\b\b\b\b\b\b\b\b\b           \b\b\b\b\b\b\b\b\b\b\b");
-    fflush(stdout);
-    return 0;
+    return failed;
 }
 
 int test_walkbits1_comparison(ulv *bufa, ulv *bufb, size_t count) {
-    ulv *p1 = bufa;
-    ulv *p2 = bufb;
     unsigned int j;
-    size_t i;
+    ul q;
+    int failed = 0;
 
-    printf("           ");
-    fflush(stdout);
     for (j = 0; j < UL_LEN * 2; j++) {
-        printf("\b\b\b\b\b\b\b\b\b\b\b");
-        p1 = (ulv *) bufa;
-        p2 = (ulv *) bufb;
-        printf("setting %3u", j);
-        fflush(stdout);
-        for (i = 0; i < count; i++) {
-            if (j < UL_LEN) { /* Walk it up. */
-                *p1++ = *p2++ = UL_ONEBITS ^ (ONE << j);
-            } else { /* Walk it back down. */
-                *p1++ = *p2++ = UL_ONEBITS ^ (ONE << (UL_LEN * 2 - j - 1));
-            }
+        progress_phase("setting", j);
+        if (j < UL_LEN) { /* Walk it up. */
+            q = UL_ONEBITS ^ (ONE << j);
+        } else { /* Walk it back down. */
+            q = UL_ONEBITS ^ (ONE << (UL_LEN * 2 - j - 1));
         }
-        printf("\b\b\b\b\b\b\b\b\b\b\b");
-        printf("testing %3u", j);
-        fflush(stdout);
-        if (compare_regions("walkbits1", bufa, bufb, count)) {
-            return -1;
+        fill_pattern(bufa, bufb, count, q, q);
+        memtester_sync();
+        progress_phase("testing", j);
+        if (compare_pattern("walkbits1", bufa, bufb, count, q, q)) {
+            fail_or_continue(failed);
         }
     }
-    printf("\b\b\b\b\b\b\b\b\b\b\b           \b\b\b\b\b\b\b\b\b\b\b");
-    fflush(stdout);
-    return 0;
+    return failed;
 }
 
 int test_bitspread_comparison(ulv *bufa, ulv *bufb, size_t count) {
-    ulv *p1 = bufa;
-    ulv *p2 = bufb;
     unsigned int j;
-    size_t i;
+    ul q;
+    int failed = 0;
 
-    printf("           ");
-    fflush(stdout);
     for (j = 0; j < UL_LEN * 2; j++) {
-        printf("\b\b\b\b\b\b\b\b\b\b\b");
-        p1 = (ulv *) bufa;
-        p2 = (ulv *) bufb;
-        printf("setting %3u", j);
-        fflush(stdout);
-        for (i = 0; i < count; i++) {
-            if (j < UL_LEN) { /* Walk it up. */
-                *p1++ = *p2++ = (i % 2 == 0)
-                    ? (ONE << j) | (ONE << (j + 2))
-                    : UL_ONEBITS ^ ((ONE << j)
-                                    | (ONE << (j + 2)));
-            } else { /* Walk it back down. */
-                *p1++ = *p2++ = (i % 2 == 0)
-                    ? (ONE << (UL_LEN * 2 - 1 - j)) | (ONE << (UL_LEN * 2 + 1 - j))
-                    : UL_ONEBITS ^ (ONE << (UL_LEN * 2 - 1 - j)
-                                    | (ONE << (UL_LEN * 2 + 1 - j)));
-            }
+        progress_phase("setting", j);
+        if (j < UL_LEN) { /* Walk it up. */
+            q = (ONE << j) | (ONE << (j + 2));
+        } else { /* Walk it back down. */
+            q = (ONE << (UL_LEN * 2 - 1 - j)) | (ONE << (UL_LEN * 2 + 1 - j));
         }
-        printf("\b\b\b\b\b\b\b\b\b\b\b");
-        printf("testing %3u", j);
-        fflush(stdout);
-        if (compare_regions("bitspread", bufa, bufb, count)) {
-            return -1;
+        fill_pattern(bufa, bufb, count, q, UL_ONEBITS ^ q);
+        memtester_sync();
+        progress_phase("testing", j);
+        if (compare_pattern("bitspread", bufa, bufb, count, q,
+                            UL_ONEBITS ^ q)) {
+            fail_or_continue(failed);
         }
     }
-    printf("\b\b\b\b\b\b\b\b\b\b\b           \b\b\b\b\b\b\b\b\b\b\b");
-    fflush(stdout);
-    return 0;
+    return failed;
 }
 
 int test_bitflip_comparison(ulv *bufa, ulv *bufb, size_t count) {
-    ulv *p1 = bufa;
-    ulv *p2 = bufb;
     unsigned int j, k;
     ul q;
-    size_t i;
+    int failed = 0;
 
-    printf("           ");
-    fflush(stdout);
     for (k = 0; k < UL_LEN; k++) {
         q = ONE << k;
         for (j = 0; j < 8; j++) {
-            printf("\b\b\b\b\b\b\b\b\b\b\b");
             q = ~q;
-            printf("setting %3u", k * 8 + j);
-            fflush(stdout);
-            p1 = (ulv *) bufa;
-            p2 = (ulv *) bufb;
-            for (i = 0; i < count; i++) {
-                *p1++ = *p2++ = (i % 2) == 0 ? q : ~q;
+            progress_phase("setting", k * 8 + j);
+            fill_pattern(bufa, bufb, count, q, ~q);
+            memtester_sync();
+            progress_phase("testing", k * 8 + j);
+            if (compare_pattern("bitflip", bufa, bufb, count, q, ~q)) {
+                fail_or_continue(failed);
             }
-            printf("\b\b\b\b\b\b\b\b\b\b\b");
-            printf("testing %3u", k * 8 + j);
-            fflush(stdout);
-            if (compare_regions("bitflip", bufa, bufb, count)) {
-                return -1;
+        }
+    }
+    return failed;
+}
+
+/*
+ * Single buffer tests (-S).  Instead of mirroring every write to bufb and
+ * comparing the two halves, each word is a pure function of its index in
+ * the whole region, a seed and the iteration number.  The verify pass
+ * recomputes the expected value in registers, so the whole locked region
+ * is tested with one write and one read per word.
+ */
+
+/* Expected value for the random pattern, a splitmix64 style hash. */
+static inline ul single_random(ul i, ul seed) {
+    ull z = (ull) i * 0x9e3779b97f4a7c15ULL + seed;
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return (ul) (z ^ (z >> 31));
+}
+
+/*
+ * Report the first of the 'nbad' mismatches of a verify pass, all of them
+ * are in the error map.  The word is read again from DRAM a few times to
+ * tell whether the wrong value is stored in memory.
+ */
+static int single_failure(const char *tname, ulv *p, size_t i, ul expected,
+                          ul actual, size_t nbad) {
+    int r, bad = 0;
+
+    for (r = 0; r < CONFIRM_READS; r++) {
+        cache_flush_range(p, sizeof(ul));
+        if (*p != expected)
+            bad++;
+    }
+    report_failure(failure_kind(bad), tname,
+                   memtester_stripe_offset + i * sizeof(ul), actual,
+                   expected);
+    if (nbad > 1 && !memtester_focusing) {
+        memtester_report_lock();
+        if (report_allowed((size_t) -1)) {
+            fprintf(stderr, "  ... and %llu more mismatching words (%s).\n",
+                    (ull) nbad - 1, tname);
+        }
+        memtester_report_unlock();
+    }
+    return -1;
+}
+
+/*
+ * The single buffer tests go through the buffer in segments: the whole
+ * buffer in the linear order, the blocks of 'order' with -R.  Returns the
+ * first word of segment 'c' and its length in 'n'.
+ */
+static size_t single_segment(const memtester_order_t *order, size_t c,
+                             size_t count, size_t *n) {
+    size_t i;
+
+    if (!memtester_random_order) {
+        *n = count;
+        return 0;
+    }
+    i = order_block(order, c);
+    *n = count - i < order->block ? count - i : order->block;
+    return i;
+}
+
+/*
+ * Define a single buffer test.  'expr' computes the value of word 'gi' (the
+ * index in the whole region) for iteration 'j', 'seed' is drawn once per
+ * iteration from the PRNG.
+ */
+#define SINGLE_BUFFER_TEST(fname, tname, iterations, expr)                 \
+int fname(ulv *buf, size_t count) {                                       \
+    ulv *p;                                                               \
+    unsigned int j;                                                       \
+    size_t i, c, k, n, nseg = 1, first = 0, nbad = 0;                     \
+    ul gi, seed, base = memtester_stripe_offset / sizeof(ul);             \
+    ul fexpected = 0, factual = 0;                                        \
+    memtester_order_t order;                                              \
+    int failed = 0;                                                       \
+                                                                          \
+    for (j = 0; j < (iterations); j++) {                                  \
+        seed = rand_ul();                                                 \
+        if (memtester_random_order) {                                     \
+            order_init(&order, count, rand_ul());                         \
+            nseg = order.nblocks;                                         \
+        }                                                                 \
+        progress_phase("setting", j);                                     \
+        for (c = 0; c < nseg; c++) {                                      \
+            k = single_segment(&order, c, count, &n);                     \
+            for (i = k, p = buf + k, gi = base + k; i < k + n;            \
+                 i++, p++, gi++) {                                        \
+                *p = (expr);                                              \
+            }                                                             \
+        }                                                                 \
+        memtester_sync();                                                 \
+        bypass_caches(buf, count);                                        \
+        if (memtester_random_order)                                       \
+            order_init(&order, count, rand_ul());                         \
+        progress_phase("testing", j);                                     \
+        for (c = 0; c < nseg; c++) {                                      \
+            k = single_segment(&order, c, count, &n);                     \
+            for (i = k, p = buf + k, gi = base + k; i < k + n;            \
+                 i++, p++, gi++) {                                        \
+                ul v = *p, expected = (expr);                             \
+                if (v != expected) {                                      \
+                    errmap_record(tname, memtester_stripe_offset +        \
+                                  i * sizeof(ul), expected, v);           \
+                    if (!nbad++) {                                        \
+                        first = i;                                        \
+                        fexpected = expected;                             \
+                        factual = v;                                      \
+                    }                                                     \
+                }                                                         \
+            }                                                             \
+        }                                                                 \
+        progress_bytes(count * sizeof(ul));                               \
+        if (nbad) {                                                       \
+            single_failure(tname, buf + first, first, fexpected, factual, \
+                           nbad);                                         \
+            fail_or_continue(failed);                                     \
+            nbad = 0;                                                     \
+        }                                                                 \
+    }                                                                     \
+    (void) seed;                                                          \
+    return failed;                                                        \
+}
+
+SINGLE_BUFFER_TEST(test_random_value_single, "random_value", 1,
+                   single_random(gi, seed))
+
+SINGLE_BUFFER_TEST(test_solidbits_single, "solidbits", 64,
+                   ((gi + j) % 2) == 0 ? UL_ONEBITS : 0)
+
+SINGLE_BUFFER_TEST(test_checkerboard_single, "checkerboard", 64,
+                   ((gi + j) % 2) == 0 ? CHECKERBOARD1 : CHECKERBOARD2)
+
+SINGLE_BUFFER_TEST(test_blockseq_single, "blockseq", 256,
+                   (ul) UL_BYTE(j))
+
+SINGLE_BUFFER_TEST(test_walkbits0_single, "walkbits0", UL_LEN * 2,
+                   j < UL_LEN ? ONE << j : ONE << (UL_LEN * 2 - j - 1))
+
+SINGLE_BUFFER_TEST(test_walkbits1_single, "walkbits1", UL_LEN * 2,
+                   UL_ONEBITS ^ (j < UL_LEN ? ONE << j
+                                            : ONE << (UL_LEN * 2 - j - 1)))
+
+SINGLE_BUFFER_TEST(test_bitspread_single, "bitspread", UL_LEN * 2,
+                   (gi % 2 == 0 ? 0 : UL_ONEBITS) ^
+                   (j < UL_LEN ? (ONE << j) | (ONE << (j + 2))
+                               : (ONE << (UL_LEN * 2 - 1 - j)) |
+                                 (ONE << (UL_LEN * 2 + 1 - j))))
+
+SINGLE_BUFFER_TEST(test_bitflip_single, "bitflip", UL_LEN * 8,
+                   ((gi + j) % 2) == 0 ? ONE << (j / 8) : ~(ONE << (j / 8)))
+
+/*
+ * Moving inversions and modulo-N.  Both tests write known values a
+ * segment at a time with the copy kernel, from a reference block in the
+ * cache.  Modulo-N verifies the segments against the reference block with
+ * the compare kernel; moving inversions reads and rewrites every word in
+ * turn with a plain loop (see movinv_block()).  bufb may be NULL (single
+ * buffer mode); otherwise bufa and bufb are handled as one region, bufb
+ * following bufa.
+ */
+struct block_failure {
+    size_t nbad;
+    size_t index;   /* words from bufa */
+    ul expected;
+    ul actual;
+};
+
+/* Verify 'n' words at 'p' against 'ref', recording every mismatch. */
+static void check_block(const char *tname, ulv *bufa, ulv *p, const ul *ref,
+                        size_t n, struct block_failure *f) {
+    size_t k;
+    ul a, b;
+
+    progress_bytes(n * sizeof(ul));
+    if (compare_regions_helper(p, (ulv *) ref, n, &a, &b) == (size_t)(-1))
+        return;
+    for (k = 0; k < n; k++) {
+        a = p[k];
+        if (a == ref[k])
+            continue;
+        errmap_record(tname, memtester_stripe_offset +
+                      (size_t) (p + k - bufa) * sizeof(ul), ref[k], a);
+        if (!f->nbad++) {
+            f->index = (size_t) (p + k - bufa);
+            f->expected = ref[k];
+            f->actual = a;
+        }
+    }
+}
+
+static int block_failures(const char *tname, ulv *bufa,
+                          struct block_failure *f) {
+    return single_failure(tname, bufa + f->index, f->index, f->expected,
+                          f->actual, f->nbad);
+}
+
+/*
+ * Verify that the 'n' words at 'p' hold 'expected' and overwrite them with
+ * 'next', going up or down.  Each word is written right after it is read,
+ * before the next one in the direction of the pass is touched, so this is
+ * a plain loop rather than the compare and copy kernels.
+ */
+static void movinv_block(const char *tname, ulv *bufa, ulv *p, ul expected,
+                         ul next, size_t n, int down,
+                         struct block_failure *f) {
+    size_t k, idx;
+    ul a;
+
+    progress_bytes(n * sizeof(ul));
+    for (k = 0; k < n; k++) {
+        idx = down ? n - 1 - k : k;
+        a = p[idx];
+        p[idx] = next;
+        if (a == expected)
+            continue;
+        errmap_record(tname, memtester_stripe_offset +
+                      (size_t) (p + idx - bufa) * sizeof(ul), expected, a);
+        if (!f->nbad++) {
+            f->index = (size_t) (p + idx - bufa);
+            f->expected = expected;
+            f->actual = a;
+        }
+    }
+}
+
+/*
+ * Fill with a pattern, then verify it and write its inverse going up
+ * through memory, then verify the inverse and write the pattern back going
+ * down.  This catches coupling faults, where writing a cell disturbs its
+ * neighbours on one side.
+ */
+static int moving_inversions(const char *tname, ulv *bufa, ulv *bufb,
+                             size_t count) {
+    ulv *regions[2];
+    ul pat[MOVINV_BLOCK], p, byte;
+    struct block_failure f = { 0 };
+    unsigned int j;
+    size_t i, n, nblocks = (count + MOVINV_BLOCK - 1) / MOVINV_BLOCK;
+    int r, nregions = bufb ? 2 : 1, failed = 0;
+
+    regions[0] = bufa;
+    regions[1] = bufb;
+    for (j = 0; j < MOVINV_PATTERNS; j++) {
+        /* All zeros, a walking one in every byte, then random. */
+        if (j == 0) {
+            p = 0;
+        } else if (j <= 8) {
+            byte = ONE << (j - 1);
+            p = UL_BYTE(byte);
+        } else {
+            p = rand_ul();
+        }
+        for (i = 0; i < MOVINV_BLOCK; i++) {
+            pat[i] = p;
+        }
+        progress_phase("setting", j);
+        for (r = 0; r < nregions; r++) {
+            for (i = 0; i < count; i += n) {
+                n = count - i < MOVINV_BLOCK ? count - i : MOVINV_BLOCK;
+                copy_region(regions[r] + i, pat, n);
+            }
+        }
+        memtester_sync();
+        bypass_caches(bufa, count);
+        bypass_caches(bufb, count);
+        progress_phase("testing", j);
+        for (r = 0; r < nregions; r++) {
+            for (i = 0; i < count; i += n) {
+                n = count - i < MOVINV_BLOCK ? count - i : MOVINV_BLOCK;
+                movinv_block(tname, bufa, regions[r] + i, p, ~p, n, 0, &f);
             }
         }
+        if (f.nbad) {
+            block_failures(tname, bufa, &f);
+            fail_or_continue(failed);
+            f.nbad = 0;
+        }
+        memtester_sync();
+        bypass_caches(bufa, count);
+        bypass_caches(bufb, count);
+        for (r = nregions; r-- > 0;) {
+            for (i = nblocks; i-- > 0;) {
+                n = count - i * MOVINV_BLOCK < MOVINV_BLOCK
+                    ? count - i * MOVINV_BLOCK : MOVINV_BLOCK;
+                movinv_block(tname, bufa, regions[r] + i * MOVINV_BLOCK, ~p,
+                             p, n, 1, &f);
+            }
+        }
+        if (f.nbad) {
+            block_failures(tname, bufa, &f);
+            fail_or_continue(failed);
+            f.nbad = 0;
+        }
+        memtester_sync();
     }
-    printf("\b\b\b\b\b\b\b\b\b\b\b           \b\b\b\b\b\b\b\b\b\b\b");
-    fflush(stdout);
-    return 0;
+    return failed;
+}
+
+/*
+ * Write a pattern to every MODULO_N-th word and its inverse to all the
+ * others, then verify, for every starting offset, with a random pattern
+ * and then its inverse.  The reference block is MODULO_N words longer than
+ * a segment so that any segment can start at the right phase.
+ */
+static int modulo_n(const char *tname, ulv *bufa, ulv *bufb, size_t count) {
+    ulv *regions[2];
+    ul ref[MODULO_BLOCK + MODULO_N], p = 0;
+    struct block_failure f = { 0 };
+    unsigned int j, offset;
+    size_t i, k, n, base = memtester_stripe_offset / sizeof(ul), gi;
+    int r, nregions = bufb ? 2 : 1, failed = 0;
+
+    regions[0] = bufa;
+    regions[1] = bufb;
+    for (j = 0; j < 2 * MODULO_N; j++) {
+        offset = j % MODULO_N;
+        if (offset == 0) {
+            p = j ? ~p : rand_ul();
+        }
+        for (k = 0; k < MODULO_BLOCK + MODULO_N; k++) {
+            ref[k] = k % MODULO_N == offset ? p : ~p;
+        }
+        progress_phase("setting", j);
+        for (r = 0; r < nregions; r++) {
+            for (i = 0; i < count; i += n) {
+                n = count - i < MODULO_BLOCK ? count - i : MODULO_BLOCK;
+                gi = base + (size_t) (regions[r] + i - bufa);
+                copy_region(regions[r] + i, ref + gi % MODULO_N, n);
+            }
+        }
+        memtester_sync();
+        bypass_caches(bufa, count);
+        bypass_caches(bufb, count);
+        progress_phase("testing", j);
+        for (r = 0; r < nregions; r++) {
+            for (i = 0; i < count; i += n) {
+                n = count - i < MODULO_BLOCK ? count - i : MODULO_BLOCK;
+                gi = base + (size_t) (regions[r] + i - bufa);
+                check_block(tname, bufa, regions[r] + i,
+                            ref + gi % MODULO_N, n, &f);
+            }
+        }
+        if (f.nbad) {
+            block_failures(tname, bufa, &f);
+            fail_or_continue(failed);
+            f.nbad = 0;
+        }
+        memtester_sync();
+    }
+    return failed;
+}
+
+int test_movinv_comparison(ulv *bufa, ulv *bufb, size_t count) {
+    return moving_inversions("movinv", bufa, bufb, count);
+}
+
+int test_modulo20_comparison(ulv *bufa, ulv *bufb, size_t count) {
+    return modulo_n("modulo20", bufa, bufb, count);
+}
+
+int test_movinv_single(ulv *buf, size_t count) {
+    return moving_inversions("movinv", buf, NULL, count);
+}
+
+int test_modulo20_single(ulv *buf, size_t count) {
+    return modulo_n("modulo20", buf, NULL, count);
 }
 
 #ifdef TEST_NARROW_WRITES    
 int test_8bit_wide_random(ulv* bufa, ulv* bufb, size_t count) {
+    /* Private copy, the workers must not share the staging word. */
+    union {
+        unsigned char bytes[UL_LEN/8];
+        ul val;
+    } mword8;
     u8v *p1, *t;
     ulv *p2;
     int attempt;
     unsigned int b, j = 0;
     size_t i;
+    int failed = 0;
 
-    putchar(' ');
-    fflush(stdout);
     for (attempt = 0; attempt < 2;  attempt++) {
         if (attempt & 1) {
             p1 = (u8v *) bufa;
@@ -534,29 +1221,30 @@ int test_8bit_wide_random(ulv* bufa, ulv* bufb, size_t count) {
                 *p1++ = *t++;
             }
             if (!(i % PROGRESSOFTEN)) {
-                putchar('\b');
-                putchar(progress[++j % PROGRESSLEN]);
-                fflush(stdout);
+                progress_spin(++j);
             }
         }
+        memtester_sync();
         if (compare_regions("8bit_wide_random", bufa, bufb, count)) {
-            return -1;
+            fail_or_continue(failed);
         }
     }
-    printf("\b \b");
-    fflush(stdout);
-    return 0;
+    return failed;
 }
 
 int test_16bit_wide_random(ulv* bufa, ulv* bufb, size_t count) {
+    /* Private copy, the workers must not share the staging word. */
+    union {
+        unsigned short u16s[UL_LEN/16];
+        ul val;
+    } mword16;
     u16v *p1, *t;
     ulv *p2;
     int attempt;
     unsigned int b, j = 0;
     size_t i;
+    int failed = 0;
 
-    putchar( ' ' );
-    fflush( stdout );
     for (attempt = 0; attempt < 2; attempt++) {
         if (attempt & 1) {
             p1 = (u16v *) bufa;
@@ -572,17 +1260,14 @@ int test_16bit_wide_random(ulv* bufa, ulv* bufb, size_t count) {
                 *p1++ = *t++;
             }
             if (!(i % PROGRESSOFTEN)) {
-                putchar('\b');
-                putchar(progress[++j % PROGRESSLEN]);
-                fflush(stdout);
+                progress_spin(++j);
             }
         }
+        memtester_sync();
         if (compare_regions("16bit_wide_random", bufa, bufb, count)) {
-            return -1;
+            fail_or_continue(failed);
         }
     }
-    printf("\b \b");
-    fflush(stdout);
-    return 0;
+    return failed;
 }
 #endif
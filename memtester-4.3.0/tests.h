@@ -16,6 +16,13 @@
 
 /* Function declaration. */
 
+void report_failure(const char *kind, const char *tname, size_t offset,
+                    unsigned long v1, unsigned long v2);
+int report_allowed(size_t offset);
+/* Print the failure reports held back by -C so far, at the end of a test. */
+void report_flush(void);
+
+int test_address_lines(unsigned long volatile *buf, size_t count);
 int test_stuck_address(unsigned long volatile *bufa, size_t count);
 int test_random_value(unsigned long volatile *bufa, unsigned long volatile *bufb, size_t count);
 int test_xor_comparison(unsigned long volatile *bufa, unsigned long volatile *bufb, size_t count);
@@ -32,6 +39,18 @@ int test_walkbits0_comparison(unsigned long volatile *bufa, unsigned long volati
 int test_walkbits1_comparison(unsigned long volatile *bufa, unsigned long volatile *bufb, size_t count);
 int test_bitspread_comparison(unsigned long volatile *bufa, unsigned long volatile *bufb, size_t count);
 int test_bitflip_comparison(unsigned long volatile *bufa, unsigned long volatile *bufb, size_t count);
+int test_movinv_comparison(unsigned long volatile *bufa, unsigned long volatile *bufb, size_t count);
+int test_modulo20_comparison(unsigned long volatile *bufa, unsigned long volatile *bufb, size_t count);
+int test_random_value_single(unsigned long volatile *buf, size_t count);
+int test_solidbits_single(unsigned long volatile *buf, size_t count);
+int test_checkerboard_single(unsigned long volatile *buf, size_t count);
+int test_blockseq_single(unsigned long volatile *buf, size_t count);
+int test_walkbits0_single(unsigned long volatile *buf, size_t count);
+int test_walkbits1_single(unsigned long volatile *buf, size_t count);
+int test_bitspread_single(unsigned long volatile *buf, size_t count);
+int test_bitflip_single(unsigned long volatile *buf, size_t count);
+int test_movinv_single(unsigned long volatile *buf, size_t count);
+int test_modulo20_single(unsigned long volatile *buf, size_t count);
 #ifdef TEST_NARROW_WRITES    
 int test_8bit_wide_random(unsigned long volatile *bufa, unsigned long volatile *bufb, size_t count);
 int test_16bit_wide_random(unsigned long volatile *bufa, unsigned long volatile *bufb, size_t count);
@@ -0,0 +1,190 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the worker pool used with -t.  Every test is run by
+ * all the workers at once, each of them on its own stripe of bufa/bufb, so
+ * that the memory controller sees requests from several CPU cores.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "types.h"
+#include "threads.h"
+
+/* Stripes are kept a multiple of this many words (whole cache lines and
+   whole iterations of the SIMD helpers). */
+#define STRIPE_ALIGN 64
+
+int memtester_threads = 1;
+
+__thread int memtester_thread_id = 0;
+__thread size_t memtester_stripe_offset = 0;
+
+static pthread_mutex_t report_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * A barrier which tolerates workers leaving early.  A test function bails
+ * out on the first failure, and the remaining workers must not wait for it
+ * forever.
+ */
+static pthread_mutex_t barrier_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t barrier_cond = PTHREAD_COND_INITIALIZER;
+static int barrier_active;
+static int barrier_waiting;
+static unsigned barrier_generation;
+
+struct worker {
+    pthread_t thread;
+    int id;
+    int (*fp)();
+    ulv *bufa;
+    ulv *bufb;
+    size_t count;
+    size_t offset;
+    int result;
+};
+
+static void barrier_release(void) {
+    barrier_waiting = 0;
+    barrier_generation++;
+    pthread_cond_broadcast(&barrier_cond);
+}
+
+void memtester_sync(void) {
+    unsigned generation;
+
+    if (memtester_threads <= 1)
+        return;
+    pthread_mutex_lock(&barrier_mutex);
+    generation = barrier_generation;
+    if (++barrier_waiting >= barrier_active) {
+        barrier_release();
+    } else {
+        while (generation == barrier_generation)
+            pthread_cond_wait(&barrier_cond, &barrier_mutex);
+    }
+    pthread_mutex_unlock(&barrier_mutex);
+}
+
+static void barrier_leave(void) {
+    pthread_mutex_lock(&barrier_mutex);
+    barrier_active--;
+    if (barrier_waiting && barrier_waiting >= barrier_active)
+        barrier_release();
+    pthread_mutex_unlock(&barrier_mutex);
+}
+
+void memtester_report_lock(void) {
+    pthread_mutex_lock(&report_mutex);
+}
+
+void memtester_report_unlock(void) {
+    pthread_mutex_unlock(&report_mutex);
+}
+
+static void *worker_main(void *data) {
+    struct worker *w = data;
+
+    memtester_thread_id = w->id;
+    memtester_stripe_offset = w->offset;
+    if (w->bufb)
+        w->result = w->fp(w->bufa, w->bufb, w->count);
+    else
+        w->result = w->fp(w->bufa, w->count);
+    barrier_leave();
+    return NULL;
+}
+
+int memtester_run_test(int (*fp)(), ulv *bufa, ulv *bufb, size_t count) {
+    struct worker workers[MEMTESTER_MAX_THREADS];
+    size_t stripe, offset = 0;
+    int i, n = memtester_threads, result = 0;
+
+    stripe = (count / n) & ~((size_t) STRIPE_ALIGN - 1);
+    if (n <= 1 || stripe == 0) {
+        memtester_thread_id = 0;
+        memtester_stripe_offset = 0;
+        return bufb ? fp(bufa, bufb, count) : fp(bufa, count);
+    }
+
+    barrier_active = n;
+    barrier_waiting = 0;
+    for (i = 0; i < n; i++) {
+        workers[i].id = i;
+        workers[i].fp = fp;
+        workers[i].bufa = bufa + offset;
+        workers[i].bufb = bufb ? bufb + offset : NULL;
+        workers[i].count = (i == n - 1) ? count - offset : stripe;
+        workers[i].offset = offset * sizeof(ul);
+        workers[i].result = 0;
+        offset += stripe;
+    }
+    for (i = 1; i < n; i++) {
+        if (pthread_create(&workers[i].thread, NULL, worker_main,
+                           &workers[i]) != 0) {
+            fprintf(stderr, "failed to start worker thread %d\n", i);
+            exit(1);
+        }
+    }
+    /* The calling thread doubles as worker 0 and prints the progress. */
+    worker_main(&workers[0]);
+    for (i = 1; i < n; i++)
+        pthread_join(workers[i].thread, NULL);
+
+    memtester_thread_id = 0;
+    memtester_stripe_offset = 0;
+    for (i = 0; i < n; i++)
+        result |= workers[i].result;
+    return result;
+}
+
+struct parallel_job {
+    pthread_t thread;
+    void (*fn)(void *arg, int id, int n);
+    void *arg;
+    int id;
+    int n;
+};
+
+static void *parallel_main(void *data) {
+    struct parallel_job *job = data;
+
+    job->fn(job->arg, job->id, job->n);
+    return NULL;
+}
+
+void memtester_run_parallel(void (*fn)(void *arg, int id, int n), void *arg,
+                            int n) {
+    struct parallel_job jobs[MEMTESTER_MAX_THREADS];
+    int i, started;
+
+    if (n > MEMTESTER_MAX_THREADS)
+        n = MEMTESTER_MAX_THREADS;
+    for (i = 0; i < n; i++) {
+        jobs[i].fn = fn;
+        jobs[i].arg = arg;
+        jobs[i].id = i;
+        jobs[i].n = n;
+    }
+    /* If a thread cannot be started, the calling thread does its share. */
+    for (started = 1; started < n; started++) {
+        if (pthread_create(&jobs[started].thread, NULL, parallel_main,
+                           &jobs[started]) != 0)
+            break;
+    }
+    for (i = started; i < n; i++)
+        fn(arg, i, n);
+    fn(arg, 0, n);
+    for (i = 1; i < started; i++)
+        pthread_join(jobs[i].thread, NULL);
+}
@@ -0,0 +1,61 @@
+/*
+ * Very simple but very effective user-space memory tester.
+ * Originally by Simon Kirby <sim@stormix.com> <sim@neato.org>
+ * Version 2 by Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Version 3 not publicly released.
+ * Version 4 rewrite:
+ * Copyright (C) 2004-2012 Charles Cazabon <charlesc-memtester@pyropus.ca>
+ * Licensed under the terms of the GNU General Public License version 2 (only).
+ * See the file COPYING for details.
+ *
+ * This file contains the declarations for the worker pool which splits the
+ * test buffers into per-thread stripes.
+ *
+ */
+
+#ifndef MEMTESTER_THREADS_H
+#define MEMTESTER_THREADS_H
+
+#include <stddef.h>
+
+#define MEMTESTER_MAX_THREADS 64
+
+/* Number of worker threads requested with -t (1 means no worker pool). */
+extern int memtester_threads;
+
+/* Per-thread state, valid inside a test function. */
+extern __thread int memtester_thread_id;
+extern __thread size_t memtester_stripe_offset; /* in bytes, from bufa */
+
+/*
+ * Run a test over the buffers, either directly or split into per-thread
+ * stripes.  With 'bufb' set to NULL the test is called as fp(bufa, count),
+ * otherwise as fp(bufa, bufb, count).  Returns non-zero if any stripe
+ * failed.
+ */
+int memtester_run_test(int (*fp)(), unsigned long volatile *bufa,
+                       unsigned long volatile *bufb, size_t count);
+
+/*
+ * Call fn(arg, id, n) from 'n' threads at once (id = 0 .. n - 1) and wait
+ * for all of them to finish.  For work which is not a test, such as
+ * faulting in the test buffer.
+ */
+void memtester_run_parallel(void (*fn)(void *arg, int id, int n), void *arg,
+                            int n);
+
+/*
+ * Wait until all the workers reach the same point of the test.  Tests call
+ * this between their "setting" and "testing" phases so that every pattern
+ * is written to the whole buffer before it is verified.
+ */
+void memtester_sync(void);
+
+/* Serialize failure reporting between the workers. */
+void memtester_report_lock(void);
+void memtester_report_unlock(void);
+
+/* Only the first worker prints progress. */
+#define memtester_is_main_thread() (memtester_thread_id == 0)
+
+#endif
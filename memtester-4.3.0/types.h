@@ -20,9 +20,24 @@ typedef unsigned long volatile ulv;
 typedef unsigned char volatile u8v;
 typedef unsigned short volatile u16v;
 
+/* Properties of a test, the flags of struct test. */
+#define TEST_NEEDS_BUFB     0x01    /* fp(bufa, bufb, count), else fp(buf, count) */
+#define TEST_NEEDS_MIRROR   0x02    /* starts from bufb equal to bufa */
+#define TEST_MIRRORS        0x04    /* leaves bufb equal to bufa if it passes */
+
+/* Tests are selected by a 64-bit mask, so a test list holds at most 64. */
+#define MAX_TESTS 64
+
 struct test {
     char *name;
     int (*fp)();
+    /*
+     * Memory traffic of one run, in passes over the whole region.  Their
+     * sum is the cost of the test in passes per word.
+     */
+    unsigned int writes;
+    unsigned int reads;
+    unsigned int flags;
 };
 
 union {